@@ -1,6 +1,7 @@
 ﻿#include <windows.h>      // Основные функции Windows API
 #include <commdlg.h>      // Диалоги открытия/сохранения файлов
 #include <commctrl.h>     // Общие элементы управления Windows
+#include <shellapi.h>     // Разбор командной строки (режим сервера)
 #include <fstream>        // Работа с файлами
 #include <sstream>        // Строковые потоки для парсинга
 #include <vector>         // Динамические массивы
@@ -11,8 +12,28 @@
 #include <iomanip>        // Форматирование вывода
 #include <locale>         // Локализация
 #include <codecvt>        // Конвертация кодировок
+#include <cstdint>        // Целые типы фиксированной ширины
+#include <cstring>        // memcpy для бинарного кэша
+#include <thread>         // Рабочие потоки
+#include <mutex>          // Синхронизация потоков
+#include <condition_variable> // Ожидание задач пулом потоков
+#include <functional>     // Задачи пула потоков
+#include <queue>          // Очередь задач
+#include <list>           // Потоки сессий сервера
+#include <random>         // Перемешивание строк по блокам
+#include <chrono>         // Замер времени
+#include <atomic>         // Счетчики учета памяти
+#include <new>            // Замена operator new/delete для учета памяти
+#include <cstdlib>        // malloc/free, strtod
+#include <cerrno>         // Переполнение при разборе чисел
+#include <climits>        // INT_MIN/INT_MAX
+#include <exception>      // Передача исключений из потоков разбора
+#include <type_traits>    // std::integral_constant для выбора числа классов
+#include <intrin.h>       // __cpuid, _BitScanForward
+#include <immintrin.h>    // SSE2/AVX2 для пакетной оценки деревьев
 
 #pragma comment(lib, "comctl32.lib")  // Подключение библиотеки элементов управления
+#pragma comment(lib, "shell32.lib")   // CommandLineToArgvW
 
 //КОНСТАНТЫ ИДЕНТИФИКАТОРОВ ЭЛЕМЕНТОВ ИНТЕРФЕЙСА
 #define ID_LOAD_BUTTON 1001      // Кнопка загрузки CSV файла
@@ -20,17 +41,215 @@
 #define ID_SAVE_BUTTON 1003      // Кнопка сохранения результатов
 #define ID_LISTBOX 1004          // Список столбцов CSV файла
 #define ID_RESULTS_TEXT 1005     // Текстовое поле для вывода результатов
+#define ID_CROSS_VALIDATION_BUTTON 1006 // Кнопка кросс-валидации и перебора параметров
+#define ID_INCREMENTAL_BUTTON 1007      // Кнопка дообучения по дописанным строкам
+#define ID_MEMORY_TRACKING_CHECK 1008   // Флажок учета памяти
+#define ID_SAMPLED_SEARCH_CHECK 1009    // Флажок выборочного поиска порогов
+#define ID_VERIFY_SAMPLED_CHECK 1010    // Флажок сверки выборочного поиска с полным перебором
 
 //ГЛОБАЛЬНЫЕ ПЕРЕМЕННЫЕ ИНТЕРФЕЙСА
 HWND hMainWindow;                    // Вызов главного окна приложения
 HWND hLoadButton, hCalculateButton, hSaveButton;  // Вызовы кнопок
+HWND hCrossValidationButton;         // Вызов кнопки кросс-валидации
+HWND hIncrementalButton;             // Вызов кнопки дообучения
+HWND hMemoryTrackingCheck;           // Вызов флажка учета памяти
+HWND hSampledSearchCheck;            // Вызов флажка выборочного поиска порогов
+HWND hVerifySampledCheck;            // Вызов флажка сверки с полным перебором
 HWND hListBox, hResultsText;         // Вызов списка и текстового поля
 
 //ГЛОБАЛЬНЫЕ ПЕРЕМЕННЫЕ ДАННЫХ
-std::vector<std::vector<std::string>> csvData;  // Двумерный массив данных из CSV файла
 std::vector<std::string> columnNames;           // Названия столбцов (заголовки CSV)
 std::wstring resultsText;                       // Текст результатов анализа для отображения
 char detectedDelimiter = ',';                   // Обнаруженный разделитель
+std::wstring loadedFileName;                    // Путь к загруженному файлу
+size_t loadedMemoryPhaseCount = 0;              // Фазы учета памяти, записанные при загрузке файла
+
+//УЧЕТ ПАМЯТИ ПО КАТЕГОРИЯМ И ФАЗАМ ОБУЧЕНИЯ (ВКЛЮЧАЕТСЯ ПОЛЬЗОВАТЕЛЕМ)
+//Замена глобальных operator new/delete добавляет 16 байт к каждому блоку, поэтому собирается
+//только при определенном C45_MEMORY_TRACKING (конфигурации Debug); без него флажок учета не создается
+
+//КАТЕГОРИИ ВЫДЕЛЕНИЙ; ТЕКУЩАЯ КАТЕГОРИЯ ЗАДАЕТСЯ ДЛЯ ПОТОКА ОБЛАСТЬЮ MemoryCategoryScope
+enum MemoryCategory {
+    MEM_OTHER = 0,
+    MEM_CSV_DATA,           // Сегменты столбцов при разборе CSV
+    MEM_TYPED_COLUMNS,      // Типизированные столбцы
+    MEM_DATA_SUBSET,        // Копии DataSubset
+    MEM_SPLIT_RESULT,       // SplitResult: индексы, метки и описание шагов
+    MEM_NODE_LABELS,        // DecisionNode::labelCounts
+    MEM_TREE_NODES,         // Узлы дерева и их описания
+    MEM_TREE_LOG,           // Двоичный журнал построения SplitTrace
+    MEM_REPORT,             // Текст отчета
+    MEM_CATEGORY_COUNT
+};
+
+const wchar_t* const memoryCategoryNames[MEM_CATEGORY_COUNT] = {
+    L"Прочее", L"Разбор CSV", L"Типизированные столбцы", L"Копии DataSubset", L"SplitResult",
+    L"Метки узлов", L"Узлы дерева", L"Журнал построения", L"Текст отчета"
+};
+
+std::atomic<bool> memoryTrackingEnabled(false);
+std::atomic<int64_t> memoryLiveBytes[MEM_CATEGORY_COUNT];
+std::atomic<int64_t> memoryPeakBytes[MEM_CATEGORY_COUNT];
+std::atomic<int64_t> memoryTotalLiveBytes(0);
+std::atomic<int64_t> memoryTotalPeakBytes(0);
+thread_local int currentMemoryCategory = MEM_OTHER;
+
+#ifdef C45_MEMORY_TRACKING
+//ЗАГОЛОВОК БЛОКА ПЕРЕД ПАМЯТЬЮ ПОЛЬЗОВАТЕЛЯ (16 байт - выравнивание malloc сохраняется)
+struct AllocationHeader {
+    uint64_t size;
+    uint32_t category;
+    uint32_t tracked;       // Блок учтен (выделен при включенном учете)
+};
+
+void raisePeak(std::atomic<int64_t>& peak, int64_t value) {
+    int64_t current = peak.load(std::memory_order_relaxed);
+    while (value > current && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+void* allocateAccounted(size_t size) {
+    AllocationHeader* header = (AllocationHeader*)malloc(size + sizeof(AllocationHeader));
+    if (!header) return nullptr;
+
+    header->size = size;
+    header->category = (uint32_t)currentMemoryCategory;
+    header->tracked = memoryTrackingEnabled.load(std::memory_order_relaxed) ? 1 : 0;
+    if (header->tracked) {
+        int64_t live = memoryLiveBytes[header->category].fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size;
+        raisePeak(memoryPeakBytes[header->category], live);
+        int64_t total = memoryTotalLiveBytes.fetch_add((int64_t)size, std::memory_order_relaxed) + (int64_t)size;
+        raisePeak(memoryTotalPeakBytes, total);
+    }
+    return header + 1;
+}
+
+void releaseAccounted(void* block) {
+    if (!block) return;
+    AllocationHeader* header = (AllocationHeader*)block - 1;
+    if (header->tracked) {
+        memoryLiveBytes[header->category].fetch_sub((int64_t)header->size, std::memory_order_relaxed);
+        memoryTotalLiveBytes.fetch_sub((int64_t)header->size, std::memory_order_relaxed);
+    }
+    free(header);
+}
+
+void* allocateOrThrow(size_t size) {
+    for (;;) {
+        void* block = allocateAccounted(size);
+        if (block) return block;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+void* operator new(size_t size) { return allocateOrThrow(size); }
+void* operator new[](size_t size) { return allocateOrThrow(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocateAccounted(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocateAccounted(size); }
+void operator delete(void* block) noexcept { releaseAccounted(block); }
+void operator delete[](void* block) noexcept { releaseAccounted(block); }
+void operator delete(void* block, size_t) noexcept { releaseAccounted(block); }
+void operator delete[](void* block, size_t) noexcept { releaseAccounted(block); }
+void operator delete(void* block, const std::nothrow_t&) noexcept { releaseAccounted(block); }
+void operator delete[](void* block, const std::nothrow_t&) noexcept { releaseAccounted(block); }
+#endif
+
+//ОБЛАСТЬ, В КОТОРОЙ ВЫДЕЛЕНИЯ ТЕКУЩЕГО ПОТОКА ОТНОСЯТСЯ К КАТЕГОРИИ
+struct MemoryCategoryScope {
+    int previous;
+    explicit MemoryCategoryScope(MemoryCategory category) : previous(currentMemoryCategory) {
+        currentMemoryCategory = category;
+    }
+    ~MemoryCategoryScope() {
+        currentMemoryCategory = previous;
+    }
+    MemoryCategoryScope(const MemoryCategoryScope&) = delete;
+    MemoryCategoryScope& operator=(const MemoryCategoryScope&) = delete;
+};
+
+//СНИМОК ФАЗЫ: ЖИВЫЕ БАЙТЫ НА КОНЕЦ ФАЗЫ И ПИК ЗА ФАЗУ
+struct MemoryPhaseReport {
+    std::wstring name;
+    int64_t liveBytes[MEM_CATEGORY_COUNT];
+    int64_t peakBytes[MEM_CATEGORY_COUNT];
+    int64_t totalPeakBytes;
+    int64_t totalLiveBytes;
+};
+
+std::vector<MemoryPhaseReport> memoryPhases;
+std::wstring activeMemoryPhase;
+
+void setMemoryTracking(bool enabled) {
+    memoryTrackingEnabled.store(enabled);
+}
+
+bool isMemoryTrackingEnabled() {
+    return memoryTrackingEnabled.load();
+}
+
+/**
+ * Начало фазы: пики сбрасываются до текущего объема живых блоков
+ */
+void beginMemoryPhase(const std::wstring& name) {
+    if (!isMemoryTrackingEnabled()) return;
+    activeMemoryPhase = name;
+    for (int c = 0; c < MEM_CATEGORY_COUNT; ++c) {
+        memoryPeakBytes[c].store(memoryLiveBytes[c].load());
+    }
+    memoryTotalPeakBytes.store(memoryTotalLiveBytes.load());
+}
+
+void endMemoryPhase() {
+    if (!isMemoryTrackingEnabled() || activeMemoryPhase.empty()) return;
+    MemoryPhaseReport report;
+    report.name = activeMemoryPhase;
+    for (int c = 0; c < MEM_CATEGORY_COUNT; ++c) {
+        report.liveBytes[c] = memoryLiveBytes[c].load();
+        report.peakBytes[c] = memoryPeakBytes[c].load();
+    }
+    report.totalPeakBytes = memoryTotalPeakBytes.load();
+    report.totalLiveBytes = memoryTotalLiveBytes.load();
+    activeMemoryPhase.clear();
+    memoryPhases.push_back(report);
+}
+
+/**
+ * Оставляет первые count фаз (например, только загрузку файла перед новым анализом)
+ */
+void discardMemoryPhasesAfter(size_t count) {
+    if (memoryPhases.size() > count) {
+        memoryPhases.resize(count);
+    }
+}
+
+std::wstring formatBytes(int64_t bytes) {
+    std::wostringstream out;
+    out << std::fixed << std::setprecision(2);
+    if (bytes >= 1024LL * 1024 * 1024) out << bytes / (1024.0 * 1024 * 1024) << L" ГБ";
+    else if (bytes >= 1024LL * 1024) out << bytes / (1024.0 * 1024) << L" МБ";
+    else if (bytes >= 1024) out << bytes / 1024.0 << L" КБ";
+    else out << bytes << L" Б";
+    return out.str();
+}
+
+std::wstring describeMemoryUsage() {
+    std::wostringstream out;
+    for (const MemoryPhaseReport& phase : memoryPhases) {
+        out << L"Фаза: " << phase.name << L"\n";
+        out << L"  Пик всего: " << formatBytes(phase.totalPeakBytes)
+            << L", в конце фазы: " << formatBytes(phase.totalLiveBytes) << L"\n";
+        for (int c = 0; c < MEM_CATEGORY_COUNT; ++c) {
+            if (phase.peakBytes[c] == 0 && phase.liveBytes[c] == 0) continue;
+            out << L"  " << std::left << std::setw(24) << memoryCategoryNames[c] << std::right
+                << L" пик " << std::setw(12) << formatBytes(phase.peakBytes[c])
+                << L", в конце " << std::setw(12) << formatBytes(phase.liveBytes[c]) << L"\n";
+        }
+        out << L"\n";
+    }
+    return out.str();
+}
 
 //СТРУКТУРА УЗЛА ДЕРЕВА РЕШЕНИЙ
 struct DecisionNode {
@@ -46,7 +265,8 @@ struct DecisionNode {
     double entropy;
 
     //ДАННЫЕ УЗЛА
-    std::vector<int> yValues;
+    std::vector<std::pair<int, int>> labelCounts;   // (метка, число образцов) для каждого класса узла
+    int sampleCount;        // Число образцов (у листьев инкрементального дерева labelCounts не хранятся)
     int predictedClass;
 
     //СТРУКТУРА ДЕРЕВА
@@ -59,17 +279,128 @@ struct DecisionNode {
 
     DecisionNode() : isLeaf(false), attributeIndex(-1), threshold(0.0),
         informationGain(0.0), splitInformation(0.0), gainRatio(0.0), entropy(0.0),
-        predictedClass(-1), depth(0) {
+        sampleCount(0), predictedClass(-1), depth(0) {
+    }
+};
+
+//ШИРИНА ХРАНЕНИЯ ЧИСЛОВОГО СТОЛБЦА (ВЫБИРАЕТСЯ ПРИ ЗАГРУЗКЕ ПО ДИАПАЗОНУ И ТОЧНОСТИ)
+enum StorageWidth : uint8_t {
+    STORAGE_INT8 = 0,
+    STORAGE_INT16 = 1,
+    STORAGE_INT32 = 2,
+    STORAGE_FLOAT = 3,
+    STORAGE_DOUBLE = 4
+};
+
+//ЧИСЛОВОЙ СТОЛБЕЦ: ЗАПОЛНЕН ТОЛЬКО ВЕКТОР ВЫБРАННОЙ ШИРИНЫ
+struct NumericColumn {
+    StorageWidth width;
+    std::vector<int8_t> int8Values;
+    std::vector<int16_t> int16Values;
+    std::vector<int32_t> int32Values;
+    std::vector<float> floatValues;
+    std::vector<double> doubleValues;
+
+    NumericColumn() : width(STORAGE_DOUBLE) {
+    }
+
+    size_t size() const {
+        switch (width) {
+        case STORAGE_INT8: return int8Values.size();
+        case STORAGE_INT16: return int16Values.size();
+        case STORAGE_INT32: return int32Values.size();
+        case STORAGE_FLOAT: return floatValues.size();
+        default: return doubleValues.size();
+        }
+    }
+
+    double at(size_t i) const {
+        switch (width) {
+        case STORAGE_INT8: return int8Values[i];
+        case STORAGE_INT16: return int16Values[i];
+        case STORAGE_INT32: return int32Values[i];
+        case STORAGE_FLOAT: return floatValues[i];
+        default: return doubleValues[i];
+        }
+    }
+};
+
+/**
+ * Вызывает visitor для вектора той ширины, в которой хранится столбец.
+ * Visitor - обобщенная лямбда, поэтому горячие циклы инстанцируются для каждого типа хранения
+ */
+template<typename Column, typename Visitor>
+void dispatchStorage(Column& column, Visitor&& visitor) {
+    switch (column.width) {
+    case STORAGE_INT8: visitor(column.int8Values); break;
+    case STORAGE_INT16: visitor(column.int16Values); break;
+    case STORAGE_INT32: visitor(column.int32Values); break;
+    case STORAGE_FLOAT: visitor(column.floatValues); break;
+    default: visitor(column.doubleValues); break;
+    }
+}
+
+//ДОСТУП К ВЕКТОРУ ХРАНЕНИЯ ПО ТИПУ ЗНАЧЕНИЯ
+template<typename T> std::vector<T>& columnStorage(NumericColumn& column);
+template<> inline std::vector<int8_t>& columnStorage<int8_t>(NumericColumn& column) { return column.int8Values; }
+template<> inline std::vector<int16_t>& columnStorage<int16_t>(NumericColumn& column) { return column.int16Values; }
+template<> inline std::vector<int32_t>& columnStorage<int32_t>(NumericColumn& column) { return column.int32Values; }
+template<> inline std::vector<float>& columnStorage<float>(NumericColumn& column) { return column.floatValues; }
+template<> inline std::vector<double>& columnStorage<double>(NumericColumn& column) { return column.doubleValues; }
+
+//ПАРАМЕТРЫ ОБУЧЕНИЯ (ПО УМОЛЧАНИЮ - КАК В ИСХОДНОМ АЛГОРИТМЕ)
+struct TrainingParams {
+    int maxDepth;               // Узел на этой глубине становится листом
+    int minSamplesSplit;        // Узел с меньшим числом образцов не разделяется
+    double pruningConfidence;   // Уровень доверия CF для обрезки C4.5 (0 - без обрезки)
+    bool levelWiseGrowth;       // Рост по уровням (LevelWiseTreeBuilder) вместо обхода в глубину
+    bool mergeDuplicateRows;    // Слияние повторяющихся строк во взвешенные (дерево то же, строк для перебора меньше)
+
+    //ВЫБОРОЧНЫЙ ПОИСК ПОРОГОВ В БОЛЬШИХ УЗЛАХ
+    int sampledSearchMinRows;   // Узлы от этого размера отбирают кандидатов по выборке (0 - всегда полный перебор)
+    int sampleSize;             // Размер случайной выборки строк
+    int shortlistSize;          // Наибольшее число атрибутов для точного уточнения (top-k)
+    double sampleConfidence;    // Доверие к оценкам по выборке: задает запас при отборе атрибутов и диапазонов
+    bool verifySampledSearch;   // Сверять выбор с полным перебором (отладка: удваивает работу в узлах с выборкой)
+
+    TrainingParams() : maxDepth(10), minSamplesSplit(2), pruningConfidence(0.0), levelWiseGrowth(false),
+        mergeDuplicateRows(false), sampledSearchMinRows(0), sampleSize(2000), shortlistSize(3), sampleConfidence(0.95),
+        verifySampledSearch(false) {
     }
 };
 
 //СТРУКТУРА ПОДМНОЖЕСТВА ДАННЫХ
 struct DataSubset {
-    std::vector<std::vector<double>> attributeValues;
+    std::vector<NumericColumn> attributeValues;
     std::vector<int> yValues;
     std::vector<int> originalRowIndices;
 };
 
+//ТИПИЗИРОВАННЫЕ СТОЛБЦЫ ДАННЫХ
+struct ColumnData {
+    bool isNumeric;                   // Более 80% непустых значений разбираются как числа
+    bool hasLabels;                   // Столбец может быть целевым (Y), хранятся метки классов
+    NumericColumn values;             // Значения std::stod (0.0 для нечисловых ячеек), только для числовых столбцов
+    std::vector<int> labels;          // Значения std::stoi, только для целевого столбца
+    std::vector<uint8_t> labelValid;  // 1, если метка класса разобрана успешно
+
+    ColumnData() : isNumeric(false), hasLabels(false) {
+    }
+};
+
+std::vector<ColumnData> typedColumns;  // Столбцы загруженного файла в типизированном виде
+size_t rowCount = 0;                   // Количество строк данных
+
+//НАБОР ДАННЫХ, ЗАГРУЖАЕМЫЙ БЕЗ ИЗМЕНЕНИЯ ГЛОБАЛЬНЫХ ПЕРЕМЕННЫХ (ИНТЕРФЕЙС ПЕРЕНОСИТ ЕГО В НИХ)
+struct LoadedDataset {
+    std::vector<std::string> columnNames;
+    std::vector<ColumnData> columns;
+    size_t rowCount;
+    char delimiter;
+
+    LoadedDataset() : rowCount(0), delimiter(',') {}
+};
+
 // ФУНКЦИИ КОНВЕРТАЦИИ КОДИРОВОК
 std::wstring utf8_to_wstring(const std::string& str) {
     if (str.empty()) return std::wstring();
@@ -90,50 +421,45 @@ std::string wstring_to_utf8(const std::wstring& wstr) {
 //ИСПРАВЛЕННЫЕ ФУНКЦИИ ДЛЯ РАБОТЫ С ФАЙЛАМИ
 
 /**
- * ИСПРАВЛЕННАЯ ФУНКЦИЯ: Определяет разделитель с использованием широких символов
+ * ИСПРАВЛЕННАЯ ФУНКЦИЯ: Определяет разделитель по началу текста файла (UTF-8: разделители и кавычки -
+ * однобайтовые символы, поэтому анализ идет прямо по байтам)
  */
-char detectDelimiter(const std::wstring& filename) {
-    std::wifstream file(filename);
-    if (!file.is_open()) {
-        return ','; // По умолчанию запятая
-    }
-
-    // ВАЖНО: Устанавливаем локаль для корректного чтения UTF-8
-    file.imbue(std::locale(std::locale::empty(), new std::codecvt_utf8<wchar_t>));
-
-    std::vector<std::wstring> testLines;
-    std::wstring line;
+char detectDelimiter(const char* data, size_t size) {
+    std::vector<std::string> testLines;
     int linesRead = 0;
     const int maxLinesToTest = 10;
 
     // Читаем несколько строк для анализа
-    while (std::getline(file, line) && linesRead < maxLinesToTest) {
-        if (!line.empty()) {
-            testLines.push_back(line);
+    size_t lineStart = 0;
+    while (lineStart < size && linesRead < maxLinesToTest) {
+        const char* lineEnd = (const char*)memchr(data + lineStart, '\n', size - lineStart);
+        size_t length = lineEnd ? (size_t)(lineEnd - (data + lineStart)) : size - lineStart;
+        if (length > 0) {
+            testLines.emplace_back(data + lineStart, length);
             linesRead++;
         }
+        lineStart += length + 1;
     }
-    file.close();
 
     if (testLines.empty()) {
-        return ',';
+        return ','; // По умолчанию запятая
     }
 
     // Тестируем различные разделители
-    std::vector<wchar_t> delimiters = { L';', L',', L'\t', L'|' };
-    std::map<wchar_t, int> scores;
+    std::vector<char> delimiters = { ';', ',', '\t', '|' };
+    std::map<char, int> scores;
 
-    for (wchar_t delim : delimiters) {
+    for (char delim : delimiters) {
         scores[delim] = 0;
         std::vector<int> columnCounts;
 
         // Анализируем каждую строку
-        for (const std::wstring& testLine : testLines) {
+        for (const std::string& testLine : testLines) {
             int count = 0;
             bool inQuotes = false;
 
-            for (wchar_t c : testLine) {
-                if (c == L'"') {
+            for (char c : testLine) {
+                if (c == '"') {
                     inQuotes = !inQuotes;
                 }
                 else if (c == delim && !inQuotes) {
@@ -168,7 +494,7 @@ char detectDelimiter(const std::wstring& filename) {
     }
 
     // Находим лучший разделитель
-    wchar_t bestDelimiter = L',';
+    char bestDelimiter = ',';
     int bestScore = 0;
 
     for (const auto& pair : scores) {
@@ -178,8 +504,7 @@ char detectDelimiter(const std::wstring& filename) {
         }
     }
 
-    // Конвертируем обратно в char
-    return (char)bestDelimiter;
+    return bestDelimiter;
 }
 
 /**
@@ -249,9 +574,96 @@ std::wstring getDelimiterName(char delimiter) {
 }
 
 //МАТЕМАТИЧЕСКИЕ ФУНКЦИИ ДЛЯ C4.5
+
+#define SMALL_CLASS_COUNT_LIMIT 4   // Наибольшее число классов со своей специализацией
+
+/**
+ * Энтропия по счетчикам классов. K - число классов, известное при компиляции
+ * (циклы разворачиваются), K = 0 - общий вариант с числом классов classCount
+ */
+template<int K>
+inline double entropyOfCounts(const int* counts, int classCount, int total) {
+    if (total == 0) return 0.0;
+
+    const int classes = K > 0 ? K : classCount;
+    double entropy = 0.0;
+    for (int c = 0; c < classes; ++c) {
+        if (counts[c] > 0) {
+            double probability = (double)counts[c] / total;
+            entropy -= probability * log2(probability);
+        }
+    }
+    return entropy;
+}
+
+/**
+ * Два класса без ветвлений: для пустого класса берется log2(0 + 1) = 0, слагаемое равно нулю,
+ * поэтому результат побитово совпадает с общим вариантом
+ */
+template<>
+inline double entropyOfCounts<2>(const int* counts, int, int total) {
+    if (total == 0) return 0.0;
+
+    double negative = (double)counts[0] / total;
+    double positive = (double)counts[1] / total;
+    double entropy = 0.0 - negative * log2(negative + (double)(counts[0] == 0));
+    return entropy - positive * log2(positive + (double)(counts[1] == 0));
+}
+
+/**
+ * Вызывает visitor с std::integral_constant<int, K>: K = 2..SMALL_CLASS_COUNT_LIMIT - специализации
+ * для малого числа классов, K = 0 - общий вариант
+ */
+template<typename Visitor>
+void dispatchClassCount(int classCount, Visitor&& visitor) {
+    switch (classCount) {
+    case 2: visitor(std::integral_constant<int, 2>()); break;
+    case 3: visitor(std::integral_constant<int, 3>()); break;
+    case 4: visitor(std::integral_constant<int, 4>()); break;
+    default: visitor(std::integral_constant<int, 0>()); break;
+    }
+}
+
+//СЧЕТЧИКИ КЛАССОВ: МАССИВ НА СТЕКЕ ДЛЯ ФИКСИРОВАННОГО K, ВЕКТОР ДЛЯ ОБЩЕГО ВАРИАНТА
+template<int K>
+struct ClassCounts {
+    int values[K];
+
+    explicit ClassCounts(int) { std::fill(values, values + K, 0); }
+    int* data() { return values; }
+};
+
+template<>
+struct ClassCounts<0> {
+    std::vector<int> values;
+
+    explicit ClassCounts(int classCount) : values(classCount, 0) {}
+    int* data() { return values.data(); }
+};
+
 double calculateEntropy(const std::vector<int>& values) {
     if (values.empty()) return 0.0;
 
+    //МЕТКИ ИЗ УЗКОГО ДИАПАЗОНА КОДИРУЮТСЯ СДВИГОМ: СЧЕТЧИКИ В МАССИВЕ, ПОРЯДОК КЛАССОВ ТОТ ЖЕ, ЧТО В std::map
+    auto range = std::minmax_element(values.begin(), values.end());
+    int low = *range.first;
+    long long span = (long long)*range.second - low + 1;
+    if (span == 2) {
+        int positive = 0;
+        for (int val : values) {
+            positive += val != low;
+        }
+        int counts[2] = { (int)values.size() - positive, positive };
+        return entropyOfCounts<2>(counts, 2, (int)values.size());
+    }
+    if (span <= SMALL_CLASS_COUNT_LIMIT) {
+        int counts[SMALL_CLASS_COUNT_LIMIT] = { 0 };
+        for (int val : values) {
+            counts[val - low]++;
+        }
+        return entropyOfCounts<0>(counts, (int)span, (int)values.size());
+    }
+
     std::map<int, int> counts;
     for (int val : values) {
         counts[val]++;
@@ -314,498 +726,5692 @@ int getMajorityClass(const std::vector<int>& values) {
     return majorityClass;
 }
 
-//ИСПРАВЛЕННЫЕ ФУНКЦИИ ДЛЯ РАБОТЫ С CSV ФАЙЛАМИ
-
 /**
- * ГЛАВНАЯ ИСПРАВЛЕННАЯ ФУНКЦИЯ: Парсинг CSV с использованием широких символов
+ * Число образцов каждой метки (по возрастанию метки)
  */
-bool parseCSV(const std::wstring& filename) {
-    // Сначала определяем разделитель
-    detectedDelimiter = detectDelimiter(filename);
-    wchar_t wideDelimiter = (wchar_t)detectedDelimiter;
-
-    // ИСПРАВЛЕНО: Используем wifstream для работы с широкими символами
-    std::wifstream file(filename);
-    if (!file.is_open()) {
-        // Дополнительная диагностика
-        std::wstring errorMsg = L"Не удалось открыть файл:\n" + filename +
-            L"\n\nПроверьте:\n• Существует ли файл\n• Нет ли русских символов в пути\n• Файл не заблокирован другой программой";
-        MessageBox(hMainWindow, errorMsg.c_str(), L"Ошибка открытия файла", MB_OK | MB_ICONERROR);
-        return false;
+std::vector<std::pair<int, int>> countLabels(const std::vector<int>& values) {
+    std::map<int, int> counts;
+    for (int val : values) {
+        counts[val]++;
     }
+    return std::vector<std::pair<int, int>>(counts.begin(), counts.end());
+}
 
-    // ВАЖНО: Устанавливаем локаль для корректного чтения UTF-8
-    file.imbue(std::locale(std::locale::empty(), new std::codecvt_utf8<wchar_t>));
-
-    // Очищаем предыдущие данные
-    csvData.clear();
-    columnNames.clear();
-
-    std::wstring line;
-    bool firstLine = true;
-    int lineNumber = 0;
-
-    // Читаем файл построчно
-    while (std::getline(file, line)) {
-        lineNumber++;
+//ИСПРАВЛЕННЫЕ ФУНКЦИИ ДЛЯ РАБОТЫ С CSV ФАЙЛАМИ
 
-        // Пропускаем пустые строки
-        if (line.empty() || line.find_first_not_of(L" \t\r\n") == std::wstring::npos) {
-            continue;
-        }
+bool isTargetColumnName(const std::string& name) {
+    return name == "Y" || name == "y";
+}
 
-        // Разбиваем строку с использованием определенного разделителя
-        std::vector<std::string> row = splitCSVLine(line, wideDelimiter);
+//ДИАПАЗОН ЗНАЧЕНИЙ СТОЛБЦА ДЛЯ ВЫБОРА ШИРИНЫ ХРАНЕНИЯ (НАКАПЛИВАЕТСЯ ПО БЛОКАМ ФАЙЛА И ОБЪЕДИНЯЕТСЯ)
+struct ValueRange {
+    bool allIntegral;
+    bool allFloat;
+    double minValue;
+    double maxValue;
 
-        if (firstLine) {
-            columnNames = row;
-            firstLine = false;
+    ValueRange() : allIntegral(true), allFloat(true), minValue(0.0), maxValue(0.0) {
+    }
 
-            // Диагностика заголовков
-            std::wstring debugInfo = L"Файл успешно открыт!\n\n";
-            MessageBox(hMainWindow, debugInfo.c_str(), L"Диагностика CSV", MB_OK | MB_ICONINFORMATION);
+    void add(double value) {
+        if (allIntegral && !(std::isfinite(value) && value == std::floor(value))) {
+            allIntegral = false;
         }
-        else {
-            // Проверяем соответствие количества колонок
-            if (row.size() != columnNames.size()) {
-                std::wstring warning = L"Предупреждение: строка " + std::to_wstring(lineNumber) +
-                    L" содержит " + std::to_wstring(row.size()) + L" колонок, ожидалось " +
-                    std::to_wstring(columnNames.size());
-
-                // Дополняем недостающие колонки пустыми значениями
-                while (row.size() < columnNames.size()) {
-                    row.push_back("");
-                }
-                // Или обрезаем лишние
-                if (row.size() > columnNames.size()) {
-                    row.resize(columnNames.size());
-                }
-            }
-            csvData.push_back(row);
+        if (allFloat && (double)(float)value != value) {
+            allFloat = false;
         }
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
     }
 
-    file.close();
-
-    if (columnNames.empty()) {
-        MessageBox(hMainWindow, L"Файл не содержит заголовков!", L"Ошибка", MB_OK | MB_ICONERROR);
-        return false;
-    }
-
-    if (csvData.empty()) {
-        MessageBox(hMainWindow, L"Файл не содержит данных!", L"Ошибка", MB_OK | MB_ICONERROR);
-        return false;
+    void merge(const ValueRange& other) {
+        allIntegral = allIntegral && other.allIntegral;
+        allFloat = allFloat && other.allFloat;
+        minValue = std::min(minValue, other.minValue);
+        maxValue = std::max(maxValue, other.maxValue);
     }
 
-    return true;
-}
-
-bool isNumericColumn(int columnIndex) {
-    if (columnIndex >= columnNames.size()) return false;
-
-    int numericCount = 0;
-    int totalCount = 0;
-
-    for (const auto& row : csvData) {
-        if (columnIndex < row.size() && !row[columnIndex].empty()) {
-            totalCount++;
-            try {
-                std::stod(row[columnIndex]);
-                numericCount++;
-            }
-            catch (...) {
-                // Не числовое значение
-            }
+    /**
+     * Самая узкая ширина, в которой все значения столбца представимы без потерь
+     */
+    StorageWidth width() const {
+        if (allIntegral) {
+            if (minValue >= INT8_MIN && maxValue <= INT8_MAX) return STORAGE_INT8;
+            if (minValue >= INT16_MIN && maxValue <= INT16_MAX) return STORAGE_INT16;
+            if (minValue >= INT32_MIN && maxValue <= INT32_MAX) return STORAGE_INT32;
         }
+        return allFloat ? STORAGE_FLOAT : STORAGE_DOUBLE;
     }
-
-    return totalCount > 0 && (double)numericCount / totalCount > 0.8;
-}
+};
 
 //ФУНКЦИИ ПОДГОТОВКИ ДАННЫХ
 DataSubset createDataSubset(const std::vector<int>& rowIndices, int yIndex, const std::vector<int>& numericColumns) {
+    MemoryCategoryScope memoryScope(MEM_DATA_SUBSET);
     DataSubset subset;
     subset.originalRowIndices = rowIndices;
     subset.attributeValues.resize(numericColumns.size());
 
-    for (int rowIdx : rowIndices) {
-        if (rowIdx < csvData.size()) {
-            const auto& row = csvData[rowIdx];
+    const ColumnData* yColumn = nullptr;
+    if (yIndex >= 0 && yIndex < (int)typedColumns.size() && typedColumns[yIndex].hasLabels) {
+        yColumn = &typedColumns[yIndex];
+    }
 
-            if (yIndex < row.size()) {
-                try {
-                    int yVal = std::stoi(row[yIndex]);
-                    subset.yValues.push_back(yVal);
-                }
-                catch (...) {
+    // Строки, попадающие в подмножество (без некорректных меток класса)
+    std::vector<int> keptRows;
+    keptRows.reserve(rowIndices.size());
+    for (int rowIdx : rowIndices) {
+        if (rowIdx < rowCount) {
+            if (yColumn) {
+                if (!yColumn->labelValid[rowIdx]) {
                     continue;
                 }
+                subset.yValues.push_back(yColumn->labels[rowIdx]);
             }
+            keptRows.push_back(rowIdx);
+        }
+    }
 
-            for (size_t i = 0; i < numericColumns.size(); ++i) {
-                int colIdx = numericColumns[i];
-                if (colIdx < row.size()) {
-                    try {
-                        double attrVal = std::stod(row[colIdx]);
-                        subset.attributeValues[i].push_back(attrVal);
-                    }
-                    catch (...) {
-                        subset.attributeValues[i].push_back(0.0);
-                    }
-                }
+    // Копирование по столбцам в исходной ширине хранения
+    for (size_t i = 0; i < numericColumns.size(); ++i) {
+        const NumericColumn& source = typedColumns[numericColumns[i]].values;
+        NumericColumn& target = subset.attributeValues[i];
+        target.width = source.width;
+        dispatchStorage(source, [&](const auto& values) {
+            typedef typename std::decay<decltype(values)>::type::value_type StorageType;
+            std::vector<StorageType>& storage = columnStorage<StorageType>(target);
+            storage.resize(keptRows.size());
+            for (size_t j = 0; j < keptRows.size(); ++j) {
+                storage[j] = values[keptRows[j]];
             }
-        }
+        });
     }
 
     return subset;
 }
 
-//СТРУКТУРА ДЛЯ РЕЗУЛЬТАТА ПОИСКА РАЗДЕЛЕНИЯ C4.5
-struct SplitResult {
-    int bestAttributeIndex;
-    double bestThreshold;
-    double bestInformationGain;
-    double bestSplitInformation;
-    double bestGainRatio;
+//БИНАРНЫЙ КОЛОНОЧНЫЙ КЭШ ЗАГРУЖЕННЫХ ФАЙЛОВ
+const char DATASET_CACHE_MAGIC[8] = { 'C', '4', '5', 'C', 'A', 'C', 'H', 'E' };
+const uint32_t DATASET_CACHE_VERSION = 3;
 
-    std::vector<int> leftIndices;
-    std::vector<int> rightIndices;
-    std::vector<int> leftY;
-    std::vector<int> rightY;
-    std::wstring detailedSteps;
+//КЛЮЧ АКТУАЛЬНОСТИ КЭША: РАЗМЕР, ВРЕМЯ ИЗМЕНЕНИЯ И ХЕШ ИСХОДНОГО ФАЙЛА
+struct DatasetCacheKey {
+    uint64_t sourceSize;
+    uint64_t sourceMtime;
+    uint64_t sourceHash;
 };
 
-//ОСНОВНАЯ ФУНКЦИЯ ПОИСКА ЛУЧШЕГО РАЗДЕЛЕНИЯ C4.5
-SplitResult findBestSplit(const DataSubset& data, const std::vector<int>& numericColumns, int depth) {
-    SplitResult result;
-    result.bestGainRatio = -1.0;
-    result.bestInformationGain = -1.0;
-    result.bestSplitInformation = 0.0;
-    result.bestAttributeIndex = -1;
-
-    std::wostringstream steps;
-    std::wstring indent = std::wstring(depth * 2, L' ');
-
-    steps << indent << L"=== ПОИСК ЛУЧШЕГО РАЗДЕЛЕНИЯ ===\n";
-    steps << indent << L"Глубина: " << depth << L"\n\n";
+//ЗАГОЛОВОК ФАЙЛА КЭША (56 байт, без выравнивающих пропусков)
+struct DatasetCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t columnCount;
+    uint64_t rowCount;
+    uint64_t sourceSize;
+    uint64_t sourceMtime;
+    uint64_t sourceHash;
+    uint32_t delimiter;
+    uint32_t reserved;
+};
 
-    double originalEntropy = calculateEntropy(data.yValues);
-    steps << indent << L"Исходная энтропия: "
-        << std::fixed << std::setprecision(4) << originalEntropy << L"\n";
-    steps << indent << L"Количество образцов: " << data.yValues.size() << L"\n";
+//ОТОБРАЖЕНИЕ ФАЙЛА В ПАМЯТЬ ТОЛЬКО ДЛЯ ЧТЕНИЯ
+struct MappedFile {
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+    const uint8_t* data;
+    uint64_t size;
 
-    // Показываем распределение классов
-    steps << indent << L"Распределение классов:\n";
-    std::map<int, int> classCounts;
-    for (int y : data.yValues) {
-        classCounts[y]++;
+    MappedFile() : fileHandle(INVALID_HANDLE_VALUE), mappingHandle(NULL), data(nullptr), size(0) {
     }
-    for (const auto& pair : classCounts) {
-        steps << indent << L"  класс " << pair.first
-            << L": " << pair.second << L" образцов\n";
+    ~MappedFile() {
+        close();
     }
-    steps << L"\n";
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::wstring& path) {
+        close();
+        fileHandle = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fileHandle == INVALID_HANDLE_VALUE) return false;
+
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+            close();
+            return false;
+        }
 
-    //ПЕРЕБОР ВСЕХ АТРИБУТОВ
-    for (size_t attrIdx = 0; attrIdx < numericColumns.size(); ++attrIdx) {
-        int columnIndex = numericColumns[attrIdx];
-        std::string attributeName = columnNames[columnIndex];
+        mappingHandle = CreateFileMappingW(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mappingHandle == NULL) {
+            close();
+            return false;
+        }
 
-        steps << indent << L"--- Анализ атрибута: "
-            << utf8_to_wstring(attributeName) << L" ---\n";
+        data = (const uint8_t*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+        if (!data) {
+            close();
+            return false;
+        }
+        size = (uint64_t)fileSize.QuadPart;
+        return true;
+    }
 
-        const auto& attributeValues = data.attributeValues[attrIdx];
+    void close() {
+        if (data) UnmapViewOfFile(data);
+        if (mappingHandle != NULL) CloseHandle(mappingHandle);
+        if (fileHandle != INVALID_HANDLE_VALUE) CloseHandle(fileHandle);
+        data = nullptr;
+        mappingHandle = NULL;
+        fileHandle = INVALID_HANDLE_VALUE;
+        size = 0;
+    }
+};
 
-        if (attributeValues.size() != data.yValues.size()) {
-            steps << indent << L"Ошибка: несоответствие размеров данных\n\n";
-            continue;
-        }
+/**
+ * 64-битный хеш содержимого (FNV-1a по 8-байтовым словам с перемешиванием)
+ */
+uint64_t hashBytes(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    const uint64_t prime = 1099511628211ULL;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t word;
+        memcpy(&word, data + i, 8);
+        hash = (hash ^ word) * prime;
+        hash ^= hash >> 29;
+    }
+    for (; i < size; ++i) {
+        hash = (hash ^ data[i]) * prime;
+    }
+    return hash ^ (uint64_t)size;
+}
 
-        std::vector<double> sortedValues = attributeValues;
-        std::sort(sortedValues.begin(), sortedValues.end());
-        sortedValues.erase(std::unique(sortedValues.begin(), sortedValues.end()), sortedValues.end());
+bool computeDatasetCacheKey(const std::wstring& filename, DatasetCacheKey& key) {
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExW(filename.c_str(), GetFileExInfoStandard, &attributes)) {
+        return false;
+    }
+    key.sourceSize = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    key.sourceMtime = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) |
+        attributes.ftLastWriteTime.dwLowDateTime;
 
-        if (sortedValues.size() < 2) {
-            steps << indent << L"Недостаточно уникальных значений\n\n";
-            continue;
-        }
+    MappedFile source;
+    if (!source.open(filename)) return false;
+    key.sourceHash = hashBytes(source.data, (size_t)source.size);
+    return true;
+}
 
-        //ПЕРЕБОР ВСЕХ ВОЗМОЖНЫХ ПОРОГОВ
-        for (size_t i = 0; i < sortedValues.size() - 1; ++i) {
-            double threshold = (sortedValues[i] + sortedValues[i + 1]) / 2.0;
+/**
+ * Возможные расположения кэша: рядом с исходным файлом и во временном каталоге
+ */
+std::vector<std::wstring> getDatasetCachePaths(const std::wstring& filename) {
+    std::vector<std::wstring> paths;
+    paths.push_back(filename + L".c45cache");
+
+    wchar_t tempPath[MAX_PATH];
+    DWORD length = GetTempPathW(MAX_PATH, tempPath);
+    if (length > 0 && length < MAX_PATH) {
+        std::wstring cacheDir = std::wstring(tempPath) + L"AlgortimC4.5";
+        CreateDirectoryW(cacheDir.c_str(), NULL);
+
+        std::string utf8Path = wstring_to_utf8(filename);
+        std::wostringstream name;
+        name << cacheDir << L"\\dataset-" << std::hex << std::setw(16) << std::setfill(L'0')
+            << hashBytes((const uint8_t*)utf8Path.data(), utf8Path.size()) << L".c45cache";
+        paths.push_back(name.str());
+    }
+    return paths;
+}
 
-            std::vector<int> leftIndices, rightIndices;
-            std::vector<int> leftY, rightY;
+void writeCachePadding(std::ofstream& out) {
+    static const char zeros[8] = { 0 };
+    std::streamoff position = out.tellp();
+    if (position % 8 != 0) {
+        out.write(zeros, 8 - position % 8);
+    }
+}
 
-            for (size_t j = 0; j < attributeValues.size(); ++j) {
-                if (attributeValues[j] < threshold) {
-                    leftIndices.push_back(data.originalRowIndices[j]);
-                    leftY.push_back(data.yValues[j]);
-                }
-                else {
-                    rightIndices.push_back(data.originalRowIndices[j]);
-                    rightY.push_back(data.yValues[j]);
-                }
+bool writeDatasetCacheFile(const std::wstring& path, const DatasetCacheKey& key, const LoadedDataset& dataset) {
+    const std::vector<std::string>& columnNames = dataset.columnNames;
+    std::wstring tempPath = path + L".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+
+        DatasetCacheHeader header;
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, DATASET_CACHE_MAGIC, sizeof(header.magic));
+        header.version = DATASET_CACHE_VERSION;
+        header.columnCount = (uint32_t)columnNames.size();
+        header.rowCount = dataset.rowCount;
+        header.sourceSize = key.sourceSize;
+        header.sourceMtime = key.sourceMtime;
+        header.sourceHash = key.sourceHash;
+        header.delimiter = (uint8_t)dataset.delimiter;
+        out.write((const char*)&header, sizeof(header));
+
+        for (size_t col = 0; col < columnNames.size(); ++col) {
+            const ColumnData& column = dataset.columns[col];
+            uint32_t nameLength = (uint32_t)columnNames[col].size();
+            uint8_t flags[4] = { (uint8_t)column.isNumeric, (uint8_t)column.hasLabels, (uint8_t)column.values.width, 0 };
+            out.write((const char*)&nameLength, sizeof(nameLength));
+            out.write((const char*)flags, sizeof(flags));
+            out.write(columnNames[col].data(), nameLength);
+            writeCachePadding(out);
+
+            if (column.isNumeric) {
+                dispatchStorage(column.values, [&](const auto& values) {
+                    out.write((const char*)values.data(), values.size() * sizeof(values[0]));
+                });
+                writeCachePadding(out);
+            }
+            if (column.hasLabels) {
+                out.write((const char*)column.labels.data(), dataset.rowCount * sizeof(int));
+                out.write((const char*)column.labelValid.data(), dataset.rowCount);
+                writeCachePadding(out);
             }
+        }
 
-            if (leftY.empty() || rightY.empty()) continue;
+        if (!out.good()) {
+            out.close();
+            DeleteFileW(tempPath.c_str());
+            return false;
+        }
+    }
 
-            //ВЫЧИСЛЕНИЕ МЕТРИК C4.5
-            double leftEntropy = calculateEntropy(leftY);
-            double rightEntropy = calculateEntropy(rightY);
+    if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
 
-            int totalSize = data.yValues.size();
-            int leftSize = leftY.size();
-            int rightSize = rightY.size();
+/**
+ * Записывает кэш рядом с файлом, а если каталог недоступен для записи - во временный каталог
+ */
+bool saveDatasetCache(const std::wstring& filename, const DatasetCacheKey& key, const LoadedDataset& dataset) {
+    for (const std::wstring& path : getDatasetCachePaths(filename)) {
+        if (writeDatasetCacheFile(path, key, dataset)) {
+            return true;
+        }
+    }
+    return false;
+}
 
-            // Information Gain
-            double weightedEntropy = ((double)leftSize / totalSize) * leftEntropy +
-                ((double)rightSize / totalSize) * rightEntropy;
-            double informationGain = originalEntropy - weightedEntropy;
+//ПОСЛЕДОВАТЕЛЬНОЕ ЧТЕНИЕ ОТОБРАЖЕННОГО КЭША С ПРОВЕРКОЙ ГРАНИЦ
+struct CacheReader {
+    const uint8_t* begin;
+    const uint8_t* position;
+    const uint8_t* end;
+
+    bool read(void* destination, size_t bytes) {
+        if ((size_t)(end - position) < bytes) return false;
+        memcpy(destination, position, bytes);
+        position += bytes;
+        return true;
+    }
 
-            // Split Information
-            double splitInformation = calculateSplitInformation(leftSize, rightSize);
+    bool align() {
+        size_t offset = (size_t)(position - begin);
+        size_t padding = (8 - offset % 8) % 8;
+        if ((size_t)(end - position) < padding) return false;
+        position += padding;
+        return true;
+    }
+};
 
-            // Gain Ratio
-            double gainRatio = calculateGainRatio(informationGain, splitInformation);
+bool readDatasetCacheFile(const std::wstring& path, const DatasetCacheKey& key, LoadedDataset& dataset) {
+    MemoryCategoryScope memoryScope(MEM_TYPED_COLUMNS);
+    MappedFile cache;
+    if (!cache.open(path)) return false;
+
+    CacheReader reader = { cache.data, cache.data, cache.data + cache.size };
+
+    DatasetCacheHeader header;
+    if (!reader.read(&header, sizeof(header)) ||
+        memcmp(header.magic, DATASET_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != DATASET_CACHE_VERSION ||
+        header.sourceSize != key.sourceSize ||
+        header.sourceMtime != key.sourceMtime ||
+        header.sourceHash != key.sourceHash ||
+        header.rowCount > cache.size) {
+        return false;
+    }
 
-            // Подробное логирование
-            steps << indent << L"Порог " << std::fixed << std::setprecision(2) << threshold << L":\n";
-            steps << indent << L"  Information Gain = " << std::fixed << std::setprecision(4) << informationGain << L"\n";
-            steps << indent << L"  Split Information = " << std::fixed << std::setprecision(4) << splitInformation << L"\n";
-            steps << indent << L"  Gain Ratio = " << std::fixed << std::setprecision(4) << gainRatio << L"\n";
-            steps << indent << L"  Левая ветвь: " << leftSize << L" образцов (энтропия: "
-                << std::fixed << std::setprecision(4) << leftEntropy << L")\n";
-            steps << indent << L"  Правая ветвь: " << rightSize << L" образцов (энтропия: "
-                << std::fixed << std::setprecision(4) << rightEntropy << L")\n";
+    std::vector<std::string> names(header.columnCount);
+    std::vector<ColumnData> columns(header.columnCount);
+    size_t rows = (size_t)header.rowCount;
+
+    for (uint32_t col = 0; col < header.columnCount; ++col) {
+        uint32_t nameLength = 0;
+        uint8_t flags[4];
+        if (!reader.read(&nameLength, sizeof(nameLength)) || !reader.read(flags, sizeof(flags))) return false;
+
+        names[col].resize(nameLength);
+        if (nameLength > 0 && !reader.read(&names[col][0], nameLength)) return false;
+        if (!reader.align()) return false;
+
+        ColumnData& column = columns[col];
+        column.isNumeric = flags[0] != 0;
+        column.hasLabels = flags[1] != 0;
+
+        if (column.isNumeric) {
+            if (flags[2] > STORAGE_DOUBLE) return false;
+            column.values.width = (StorageWidth)flags[2];
+
+            bool valuesRead = false;
+            dispatchStorage(column.values, [&](auto& values) {
+                values.resize(rows);
+                valuesRead = reader.read(values.data(), rows * sizeof(values[0])) && reader.align();
+            });
+            if (!valuesRead) return false;
+        }
+        if (column.hasLabels) {
+            column.labels.resize(rows);
+            column.labelValid.resize(rows);
+            if (!reader.read(column.labels.data(), rows * sizeof(int)) ||
+                !reader.read(column.labelValid.data(), rows) ||
+                !reader.align()) {
+                return false;
+            }
+        }
+    }
 
-            if (gainRatio > result.bestGainRatio) {
-                result.bestGainRatio = gainRatio;
-                result.bestInformationGain = informationGain;
-                result.bestSplitInformation = splitInformation;
-                result.bestAttributeIndex = columnIndex;
-                result.bestThreshold = threshold;
-                result.leftIndices = leftIndices;
-                result.rightIndices = rightIndices;
-                result.leftY = leftY;
-                result.rightY = rightY;
+    dataset.columnNames.swap(names);
+    dataset.columns.swap(columns);
+    dataset.rowCount = rows;
+    dataset.delimiter = (char)header.delimiter;
+    return true;
+}
 
-                steps << indent << L"  !!!НОВЫЙ ЛУЧШИЙ РЕЗУЛЬТАТ!!!\n";
-            }
-            steps << L"\n";
+bool loadDatasetCache(const std::wstring& filename, const DatasetCacheKey& key, LoadedDataset& dataset) {
+    for (const std::wstring& path : getDatasetCachePaths(filename)) {
+        if (readDatasetCacheFile(path, key, dataset)) {
+            return true;
         }
     }
+    return false;
+}
 
-    //ВЫВОД ИТОГОВОГО РЕЗУЛЬТАТА
-    if (result.bestGainRatio > 0) {
-        steps << indent << L"ЛУЧШЕЕ РАЗДЕЛЕНИЕ:\n";
-        steps << indent << L"Атрибут: "
-            << utf8_to_wstring(columnNames[result.bestAttributeIndex]) << L"\n";
-        steps << indent << L"Порог: "
-            << std::fixed << std::setprecision(2) << result.bestThreshold << L"\n";
-        steps << indent << L"Information Gain: "
-            << std::fixed << std::setprecision(4) << result.bestInformationGain << L"\n";
-        steps << indent << L"Split Information: "
-            << std::fixed << std::setprecision(4) << result.bestSplitInformation << L"\n";
-        steps << indent << L"Gain Ratio: "
-            << std::fixed << std::setprecision(4) << result.bestGainRatio << L"\n";
-        steps << indent << L"Левая ветвь: " << result.leftY.size()
+//ПАРАЛЛЕЛЬНЫЙ РАЗБОР CSV ПО БЛОКАМ
+
+#define CSV_MIN_CHUNK_BYTES (4 << 20)   // Меньший объем на поток не окупает запуск потоков
+
+unsigned defaultThreadCount();
+
+//СЕГМЕНТ СТОЛБЦА ОДНОГО БЛОКА: ЗНАЧЕНИЯ СТРОК БЛОКА И СТАТИСТИКА ДЛЯ ВЫБОРА ТИПА СТОЛБЦА
+//Пока все непустые ячейки числовые, значения хранятся для каждой строки; с первой нечисловой ячейки -
+//только ненулевые числа с номерами строк (текстовый столбец почти не занимает памяти)
+struct CSVColumnSegment {
+    bool denseValues;
+    std::vector<double> values;         // Все строки блока: 0.0 для пустых ячеек (пока denseValues)
+    std::vector<uint32_t> sparseRows;   // Строки блока с ненулевыми числами (после отказа от values)
+    std::vector<double> sparseValues;
+    std::vector<int> labels;            // Только для целевого столбца
+    std::vector<uint8_t> labelValid;
+    ValueRange range;
+    size_t numericCount;
+    size_t totalCount;                  // Непустые ячейки
+
+    CSVColumnSegment() : denseValues(true), numericCount(0), totalCount(0) {
+    }
+
+    /**
+     * Переход к хранению только ненулевых чисел (встретилась нечисловая ячейка)
+     */
+    void dropDenseValues() {
+        for (size_t row = 0; row < values.size(); ++row) {
+            if (values[row] != 0.0) {
+                sparseRows.push_back((uint32_t)row);
+                sparseValues.push_back(values[row]);
+            }
+        }
+        std::vector<double>().swap(values);
+        denseValues = false;
+    }
+};
+
+//БЛОК ФАЙЛА: ДИАПАЗОН ЦЕЛЫХ ЗАПИСЕЙ [begin, end) И СЕГМЕНТЫ ЕГО СТОЛБЦОВ
+struct CSVChunk {
+    size_t begin;
+    size_t end;
+    size_t rowCount;
+    size_t firstRow;                    // Номер первой строки блока в итоговых столбцах
+    std::vector<CSVColumnSegment> columns;
+
+    CSVChunk() : begin(0), end(0), rowCount(0), firstRow(0) {
+    }
+};
+
+thread_local bool runningInThreadPool = false;   // Поток принадлежит ThreadPool: ядра уже заняты пулом
+
+/**
+ * Выполняет task(0) ... task(count - 1) не более чем в threadCount потоках (один из них - вызывающий)
+ * и ждет завершения; исключение из любого потока передается вызывающему.
+ * Из задачи ThreadPool выполняется последовательно, чтобы --threads N не превращалось в N × ядер потоков
+ */
+template<typename Task>
+void runParallel(size_t count, Task&& task, size_t threadCount = defaultThreadCount()) {
+    if (runningInThreadPool) {
+        threadCount = 1;
+    }
+    std::exception_ptr failure;
+    std::mutex failureMutex;
+    std::atomic<size_t> nextIndex(0);
+    auto worker = [&]() {
+        try {
+            for (size_t index; (index = nextIndex++) < count;) {
+                task(index);
+            }
+        }
+        catch (...) {
+            std::lock_guard<std::mutex> lock(failureMutex);
+            if (!failure) failure = std::current_exception();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < std::min(count, threadCount); ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (failure) std::rethrow_exception(failure);
+}
+
+inline bool isCSVBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void trimCSVField(std::string& field) {
+    size_t start = field.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos) {
+        field.clear();
+        return;
+    }
+    field.erase(field.find_last_not_of(" \t\r\n") + 1);
+    field.erase(0, start);
+}
+
+/**
+ * Разбирает запись, начинающуюся в position, по правилам splitCSVLine: поля без кавычек и крайних пробелов
+ * в fields[0, fieldCount). Перевод строки внутри кавычек принадлежит полю. Возвращает позицию после записи;
+ * blank - запись только из пробельных символов (пропускается, как пустая строка)
+ */
+size_t readCSVRecord(const char* data, size_t position, size_t end, char delimiter,
+    std::vector<std::string>& fields, size_t& fieldCount, bool& blank) {
+    fieldCount = 0;
+    blank = true;
+    bool inQuotes = false;
+    auto nextField = [&]() -> std::string& {
+        if (fieldCount == fields.size()) fields.emplace_back();
+        std::string& field = fields[fieldCount++];
+        field.clear();
+        return field;
+    };
+
+    std::string* current = &nextField();
+    while (position < end) {
+        char c = data[position++];
+        if (!isCSVBlank(c)) blank = false;
+
+        if (c == '"') {
+            if (inQuotes && position < end && data[position] == '"') {
+                *current += '"';
+                ++position;
+            }
+            else {
+                inQuotes = !inQuotes;
+            }
+        }
+        else if (c == '\n' && !inQuotes) {
+            break;
+        }
+        else if (c == delimiter && !inQuotes) {
+            trimCSVField(*current);
+            current = &nextField();
+        }
+        else {
+            *current += c;
+        }
+    }
+    trimCSVField(*current);
+    return position;
+}
+
+/**
+ * Число ячейки по правилам std::stod (без исключений)
+ */
+bool parseCSVDouble(const std::string& cell, double& value) {
+    const char* text = cell.c_str();
+    char* parsedEnd = nullptr;
+    errno = 0;
+    double parsed = strtod(text, &parsedEnd);
+    if (parsedEnd == text || errno == ERANGE) return false;
+    value = parsed;
+    return true;
+}
+
+/**
+ * Метка класса по правилам std::stoi (без исключений)
+ */
+bool parseCSVInt(const std::string& cell, int& value) {
+    const char* text = cell.c_str();
+    char* parsedEnd = nullptr;
+    errno = 0;
+    long parsed = strtol(text, &parsedEnd, 10);
+    if (parsedEnd == text || errno == ERANGE || parsed < INT_MIN || parsed > INT_MAX) return false;
+    value = (int)parsed;
+    return true;
+}
+
+/**
+ * Разбирает записи блока в сегменты его столбцов. Недостающие поля строки считаются пустыми,
+ * лишние отбрасываются (как дополнение и обрезка строк при последовательном разборе)
+ */
+void parseCSVChunk(const char* data, char delimiter, const std::vector<uint8_t>& labelColumns, CSVChunk& chunk) {
+    MemoryCategoryScope memoryScope(MEM_CSV_DATA);
+    size_t columnCount = labelColumns.size();
+    chunk.columns.assign(columnCount, CSVColumnSegment());
+    chunk.rowCount = 0;
+
+    std::vector<std::string> fields;
+    size_t fieldCount = 0;
+    bool blank = true;
+    const std::string emptyCell;
+
+    size_t position = chunk.begin;
+    while (position < chunk.end) {
+        position = readCSVRecord(data, position, chunk.end, delimiter, fields, fieldCount, blank);
+        if (blank) continue;
+
+        for (size_t col = 0; col < columnCount; ++col) {
+            const std::string& cell = col < fieldCount ? fields[col] : emptyCell;
+            CSVColumnSegment& segment = chunk.columns[col];
+
+            double value = 0.0;
+            bool numeric = false;
+            if (!cell.empty()) {
+                segment.totalCount++;
+                numeric = parseCSVDouble(cell, value);
+                if (numeric) {
+                    segment.numericCount++;
+                }
+                else if (segment.denseValues) {
+                    segment.dropDenseValues();
+                }
+            }
+            if (segment.denseValues) {
+                segment.values.push_back(value);
+            }
+            else if (value != 0.0) {
+                segment.sparseRows.push_back((uint32_t)chunk.rowCount);
+                segment.sparseValues.push_back(value);
+            }
+            segment.range.add(value);
+
+            if (labelColumns[col]) {
+                int label = 0;
+                bool valid = parseCSVInt(cell, label);
+                segment.labels.push_back(valid ? label : 0);
+                segment.labelValid.push_back(valid ? 1 : 0);
+            }
+        }
+        chunk.rowCount++;
+    }
+}
+
+/**
+ * Позиция после первого перевода строки вне кавычек, начиная с position (inQuotes - состояние в position)
+ */
+size_t findCSVRecordStart(const char* data, size_t position, size_t end, bool inQuotes) {
+    for (; position < end; ++position) {
+        if (data[position] == '"') {
+            inQuotes = !inQuotes;
+        }
+        else if (data[position] == '\n' && !inQuotes) {
+            return position + 1;
+        }
+    }
+    return end;
+}
+
+/**
+ * Делит записи [begin, end) на блоки по границам записей. Состояние кавычек в точке деления -
+ * четность числа кавычек до нее (экранированная пара "" не меняет четность); кавычки в частях
+ * считаются параллельно
+ */
+std::vector<CSVChunk> splitCSVChunks(const char* data, size_t begin, size_t end, size_t chunkCount) {
+    std::vector<size_t> nominal(chunkCount + 1);
+    for (size_t k = 0; k <= chunkCount; ++k) {
+        nominal[k] = begin + (end - begin) / chunkCount * k;
+    }
+    nominal[chunkCount] = end;
+
+    std::vector<size_t> quoteCounts(chunkCount, 0);
+    runParallel(chunkCount, [&](size_t k) {
+        quoteCounts[k] = (size_t)std::count(data + nominal[k], data + nominal[k + 1], '"');
+    });
+
+    std::vector<CSVChunk> chunks(chunkCount);
+    size_t quotesBefore = 0;
+    size_t start = begin;
+    for (size_t k = 0; k < chunkCount; ++k) {
+        chunks[k].begin = start;
+        if (k + 1 < chunkCount) {
+            quotesBefore += quoteCounts[k];
+            start = std::max(start, findCSVRecordStart(data, nominal[k + 1], end, quotesBefore % 2 == 1));
+        }
+        else {
+            start = end;
+        }
+        chunks[k].end = start;
+    }
+    return chunks;
+}
+
+/**
+ * Ищет заголовок (первую непустую запись) в [position, end) и сдвигает position за него.
+ * Если заголовка нет, position указывает на end
+ */
+bool readCSVHeader(const char* data, size_t& position, size_t end, LoadedDataset& dataset,
+    std::vector<uint8_t>& labelColumns) {
+    std::vector<std::string> fields;
+    size_t fieldCount = 0;
+    bool blank = true;
+    while (blank && position < end) {
+        position = readCSVRecord(data, position, end, dataset.delimiter, fields, fieldCount, blank);
+    }
+    if (blank) {
+        return false;
+    }
+
+    dataset.columnNames.assign(fields.begin(), fields.begin() + fieldCount);
+    labelColumns.assign(fieldCount, 0);
+    for (size_t col = 0; col < fieldCount; ++col) {
+        labelColumns[col] = isTargetColumnName(dataset.columnNames[col]) ? 1 : 0;
+    }
+    return true;
+}
+
+/**
+ * Сводит сегменты блоков в типизированные столбцы dataset: тип и ширина столбца выбираются
+ * по статистике всех блоков, после чего каждый блок записывает свои значения на свое место
+ */
+bool assembleCSVColumns(std::vector<CSVChunk>& chunks, const std::vector<uint8_t>& labelColumns,
+    LoadedDataset& dataset, std::wstring& errorTitle, std::wstring& error) {
+    const std::vector<std::string>& columnNames = dataset.columnNames;
+    size_t rows = 0;
+    for (CSVChunk& chunk : chunks) {
+        chunk.firstRow = rows;
+        rows += chunk.rowCount;
+    }
+    if (rows == 0) {
+        errorTitle = L"Ошибка";
+        error = L"Файл не содержит данных!";
+        return false;
+    }
+
+    MemoryCategoryScope memoryScope(MEM_TYPED_COLUMNS);
+    dataset.rowCount = rows;
+    dataset.columns.assign(columnNames.size(), ColumnData());
+    for (size_t col = 0; col < columnNames.size(); ++col) {
+        ColumnData& column = dataset.columns[col];
+        column.hasLabels = labelColumns[col] != 0;
+
+        ValueRange range;
+        size_t numericCount = 0;
+        size_t totalCount = 0;
+        for (const CSVChunk& chunk : chunks) {
+            range.merge(chunk.columns[col].range);
+            numericCount += chunk.columns[col].numericCount;
+            totalCount += chunk.columns[col].totalCount;
+        }
+
+        column.isNumeric = totalCount > 0 && (double)numericCount / totalCount > 0.8;
+        if (column.isNumeric) {
+            column.values.width = range.width();
+            dispatchStorage(column.values, [&](auto& storage) {
+                storage.resize(rows);
+            });
+        }
+        if (column.hasLabels) {
+            column.labels.resize(rows);
+            column.labelValid.resize(rows);
+        }
+    }
+
+    runParallel(chunks.size(), [&](size_t k) {
+        CSVChunk& chunk = chunks[k];
+        for (size_t col = 0; col < columnNames.size(); ++col) {
+            ColumnData& column = dataset.columns[col];
+            CSVColumnSegment& segment = chunk.columns[col];
+            if (column.isNumeric) {
+                dispatchStorage(column.values, [&](auto& storage) {
+                    typedef typename std::decay<decltype(storage)>::type::value_type StorageType;
+                    if (segment.denseValues) {
+                        for (size_t i = 0; i < chunk.rowCount; ++i) {
+                            storage[chunk.firstRow + i] = (StorageType)segment.values[i];
+                        }
+                        return;
+                    }
+                    std::fill(storage.begin() + chunk.firstRow, storage.begin() + chunk.firstRow + chunk.rowCount,
+                        (StorageType)0);
+                    for (size_t i = 0; i < segment.sparseRows.size(); ++i) {
+                        storage[chunk.firstRow + segment.sparseRows[i]] = (StorageType)segment.sparseValues[i];
+                    }
+                });
+            }
+            if (column.hasLabels) {
+                std::copy(segment.labels.begin(), segment.labels.end(), column.labels.begin() + chunk.firstRow);
+                std::copy(segment.labelValid.begin(), segment.labelValid.end(), column.labelValid.begin() + chunk.firstRow);
+            }
+            CSVColumnSegment().values.swap(segment.values);
+            CSVColumnSegment().sparseRows.swap(segment.sparseRows);
+            CSVColumnSegment().sparseValues.swap(segment.sparseValues);
+        }
+    });
+    return true;
+}
+
+/**
+ * Разбор текста CSV в типизированные столбцы dataset (разделитель уже записан в dataset).
+ * Блоки разбираются и переводятся в числа параллельно
+ */
+bool parseCSVBuffer(const char* data, size_t size, LoadedDataset& dataset, std::wstring& errorTitle,
+    std::wstring& error) {
+    size_t position = 0;
+    std::vector<uint8_t> labelColumns;
+    if (!readCSVHeader(data, position, size, dataset, labelColumns)) {
+        errorTitle = L"Ошибка";
+        error = L"Файл не содержит заголовков!";
+        return false;
+    }
+
+    size_t chunkCount = std::max<size_t>(1, std::min<size_t>(defaultThreadCount(), (size - position) / CSV_MIN_CHUNK_BYTES));
+    std::vector<CSVChunk> chunks = splitCSVChunks(data, position, size, chunkCount);
+    runParallel(chunks.size(), [&](size_t k) {
+        parseCSVChunk(data, dataset.delimiter, labelColumns, chunks[k]);
+    });
+    return assembleCSVColumns(chunks, labelColumns, dataset, errorTitle, error);
+}
+
+/**
+ * Позиция после последнего перевода строки вне кавычек (0 - в тексте нет полной записи)
+ */
+size_t findLastCSVRecordEnd(const char* data, size_t size) {
+    size_t lastEnd = 0;
+    bool inQuotes = false;
+    for (size_t i = 0; i < size; ++i) {
+        if (data[i] == '"') {
+            inQuotes = !inQuotes;
+        }
+        else if (data[i] == '\n' && !inQuotes) {
+            lastEnd = i + 1;
+        }
+    }
+    return lastEnd;
+}
+
+//РАСПАКОВКА GZIP (DEFLATE, RFC 1951/1952) В ОТДЕЛЬНОМ ПОТОКЕ С ПОТОКОВЫМ РАЗБОРОМ CSV
+
+#define INFLATE_WINDOW_SIZE 32768           // Наибольшее расстояние обратной ссылки DEFLATE
+#define INFLATE_BLOCK_SIZE (1 << 20)        // Блок распакованного текста, передаваемый разбору
+#define INFLATE_QUEUE_BLOCKS 4              // Блоков в очереди между распаковкой и разбором
+
+//ФОРМАТ СЖАТИЯ ПО СИГНАТУРЕ ФАЙЛА
+enum CompressionFormat {
+    COMPRESSION_NONE,
+    COMPRESSION_GZIP,
+    COMPRESSION_ZSTD
+};
+
+CompressionFormat detectCompression(const uint8_t* data, size_t size) {
+    if (size >= 2 && data[0] == 0x1F && data[1] == 0x8B) return COMPRESSION_GZIP;
+    if (size >= 4 && data[0] == 0x28 && data[1] == 0xB5 && data[2] == 0x2F && data[3] == 0xFD) return COMPRESSION_ZSTD;
+    return COMPRESSION_NONE;
+}
+
+CompressionFormat detectFileCompression(const std::wstring& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    uint8_t signature[4] = { 0 };
+    file.read((char*)signature, sizeof(signature));
+    return detectCompression(signature, (size_t)file.gcount());
+}
+
+/**
+ * CRC-32 (полином 0xEDB88320) для проверки распакованных данных gzip
+ */
+uint32_t updateCrc32(uint32_t crc, const uint8_t* data, size_t size) {
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> values(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            values[n] = c;
+        }
+        return values;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+//ЧТЕНИЕ БИТОВ DEFLATE (МЛАДШИЙ БИТ ПЕРВЫМ); ЗА КОНЦОМ ДАННЫХ ПОДСТАВЛЯЮТСЯ НУЛИ И ОТМЕЧАЕТСЯ ВЫХОД ЗА ГРАНИЦУ
+struct BitReader {
+    const uint8_t* data;
+    size_t size;
+    size_t position;    // Следующий байт для загрузки в bits
+    uint64_t bits;
+    int bitCount;
+
+    BitReader(const uint8_t* input, size_t inputSize, size_t start) : data(input), size(inputSize),
+        position(start), bits(0), bitCount(0) {
+    }
+
+    void refill() {
+        while (bitCount <= 56) {
+            uint64_t byte = position < size ? data[position] : 0;
+            position++;
+            bits |= byte << bitCount;
+            bitCount += 8;
+        }
+    }
+
+    uint32_t read(int count) {
+        if (count == 0) return 0;
+        if (bitCount < count) refill();
+        uint32_t value = (uint32_t)(bits & ((1ull << count) - 1));
+        bits >>= count;
+        bitCount -= count;
+        return value;
+    }
+
+    void alignToByte() {
+        bits >>= bitCount % 8;
+        bitCount -= bitCount % 8;
+    }
+
+    // Позиция первого непрочитанного байта
+    size_t bytePosition() const {
+        return position - bitCount / 8;
+    }
+
+    bool overrun() const {
+        return bytePosition() > size;
+    }
+};
+
+//ТАБЛИЦА ДЕКОДИРОВАНИЯ ХАФФМАНА: ИНДЕКС - СЛЕДУЮЩИЕ maxLength БИТ ПОТОКА, ЗНАЧЕНИЕ - (СИМВОЛ << 4) | ДЛИНА КОДА
+struct HuffmanTable {
+    std::vector<uint16_t> entries;
+    int maxLength;
+
+    HuffmanTable() : maxLength(0) {
+    }
+
+    /**
+     * Канонический код по длинам; неполный код допускается (неиспользуемые записи нулевые - ошибка при чтении)
+     */
+    bool build(const uint8_t* lengths, int count) {
+        int lengthCount[16] = { 0 };
+        maxLength = 0;
+        for (int i = 0; i < count; ++i) {
+            lengthCount[lengths[i]]++;
+            maxLength = std::max(maxLength, (int)lengths[i]);
+        }
+        lengthCount[0] = 0;
+
+        int available = 1;
+        for (int length = 1; length <= 15; ++length) {
+            available = (available << 1) - lengthCount[length];
+            if (available < 0) return false;
+        }
+
+        int nextCode[16] = { 0 };
+        int code = 0;
+        for (int length = 1; length <= 15; ++length) {
+            code = (code + lengthCount[length - 1]) << 1;
+            nextCode[length] = code;
+        }
+
+        maxLength = std::max(maxLength, 1);
+        entries.assign((size_t)1 << maxLength, 0);
+        for (int symbol = 0; symbol < count; ++symbol) {
+            int length = lengths[symbol];
+            if (length == 0) continue;
+
+            int reversed = 0;
+            for (int bit = 0, value = nextCode[length]++; bit < length; ++bit, value >>= 1) {
+                reversed = (reversed << 1) | (value & 1);
+            }
+            for (size_t index = reversed; index < entries.size(); index += (size_t)1 << length) {
+                entries[index] = (uint16_t)((symbol << 4) | length);
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Следующий символ потока (-1 - код не существует)
+     */
+    int decode(BitReader& reader) const {
+        if (reader.bitCount < maxLength) reader.refill();
+        uint16_t entry = entries[reader.bits & ((1u << maxLength) - 1)];
+        int length = entry & 15;
+        if (length == 0) return -1;
+        reader.bits >>= length;
+        reader.bitCount -= length;
+        return entry >> 4;
+    }
+};
+
+//РАСПАКОВКА ЧЛЕНОВ GZIP: ТЕКСТ ПЕРЕДАЕТСЯ БЛОКАМИ, В ПАМЯТИ ТОЛЬКО ОКНО ОБРАТНЫХ ССЫЛОК И ТЕКУЩИЙ БЛОК
+struct GzipInflater {
+    const uint8_t* data;
+    size_t size;
+    std::function<bool(const uint8_t*, size_t)> emit;   // false - получатель прекратил чтение
+    std::vector<uint8_t> output;    // Окно (INFLATE_WINDOW_SIZE байт истории) и текущий блок
+    size_t outputSize;
+    size_t emitStart;               // Начало еще не переданной части output
+    uint32_t crc;
+    uint64_t memberSize;
+    bool cancelled;
+    std::wstring error;
+
+    GzipInflater(const uint8_t* input, size_t inputSize, std::function<bool(const uint8_t*, size_t)> sink) :
+        data(input), size(inputSize), emit(std::move(sink)), outputSize(0), emitStart(0), crc(0), memberSize(0),
+        cancelled(false) {
+        output.resize(INFLATE_WINDOW_SIZE + INFLATE_BLOCK_SIZE);
+    }
+
+    bool fail(const std::wstring& message) {
+        if (error.empty()) error = message;
+        return false;
+    }
+
+    /**
+     * Передает накопленный текст получателю и оставляет в буфере только окно истории
+     */
+    bool flush() {
+        if (outputSize > emitStart) {
+            crc = updateCrc32(crc, output.data() + emitStart, outputSize - emitStart);
+            memberSize += outputSize - emitStart;
+            if (!emit(output.data() + emitStart, outputSize - emitStart)) {
+                cancelled = true;
+                return false;
+            }
+        }
+        if (outputSize > INFLATE_WINDOW_SIZE) {
+            memmove(output.data(), output.data() + outputSize - INFLATE_WINDOW_SIZE, INFLATE_WINDOW_SIZE);
+            outputSize = INFLATE_WINDOW_SIZE;
+        }
+        emitStart = outputSize;
+        return true;
+    }
+
+    bool inflateStored(BitReader& reader) {
+        reader.alignToByte();
+        uint32_t length = reader.read(16);
+        uint32_t complement = reader.read(16);
+        if ((length ^ 0xFFFF) != complement) return fail(L"поврежден несжатый блок");
+        for (uint32_t i = 0; i < length; ++i) {
+            if (outputSize == output.size() && !flush()) return false;
+            output[outputSize++] = (uint8_t)reader.read(8);
+        }
+        return !reader.overrun() || fail(L"файл обрывается внутри блока");
+    }
+
+    bool inflateCodes(BitReader& reader, const HuffmanTable& literals, const HuffmanTable& distances) {
+        static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+            35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+            3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+            257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+        static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+            7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        for (;;) {
+            int symbol = literals.decode(reader);
+            if (symbol < 0 || reader.overrun()) return fail(L"поврежденные сжатые данные");
+            if (symbol == 256) return true;
+
+            // Место для литерала или самой длинной ссылки
+            if (outputSize + 258 > output.size() && !flush()) return false;
+
+            if (symbol < 256) {
+                output[outputSize++] = (uint8_t)symbol;
+                continue;
+            }
+
+            symbol -= 257;
+            if (symbol >= 29) return fail(L"неверный код длины");
+            size_t length = lengthBase[symbol] + reader.read(lengthExtra[symbol]);
+
+            int distanceSymbol = distances.decode(reader);
+            if (distanceSymbol < 0 || distanceSymbol >= 30) return fail(L"неверный код расстояния");
+            size_t distance = distanceBase[distanceSymbol] + reader.read(distanceExtra[distanceSymbol]);
+            // Ссылка не может выходить за начало текущего члена: окно хранит и текст предыдущих членов
+            if (distance > memberSize + (outputSize - emitStart)) return fail(L"ссылка за пределы распакованных данных");
+
+            uint8_t* target = output.data() + outputSize;
+            const uint8_t* source = target - distance;
+            for (size_t i = 0; i < length; ++i) {
+                target[i] = source[i];
+            }
+            outputSize += length;
+        }
+    }
+
+    bool inflateFixed(BitReader& reader) {
+        static const std::pair<HuffmanTable, HuffmanTable> tables = [] {
+            uint8_t lengths[288];
+            std::fill(lengths, lengths + 144, 8);
+            std::fill(lengths + 144, lengths + 256, 9);
+            std::fill(lengths + 256, lengths + 280, 7);
+            std::fill(lengths + 280, lengths + 288, 8);
+            std::pair<HuffmanTable, HuffmanTable> fixed;
+            fixed.first.build(lengths, 288);
+            std::fill(lengths, lengths + 30, 5);
+            fixed.second.build(lengths, 30);
+            return fixed;
+        }();
+        return inflateCodes(reader, tables.first, tables.second);
+    }
+
+    bool inflateDynamic(BitReader& reader) {
+        static const uint8_t order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+        int literalCount = (int)reader.read(5) + 257;
+        int distanceCount = (int)reader.read(5) + 1;
+        int codeLengthCount = (int)reader.read(4) + 4;
+        if (literalCount > 286 || distanceCount > 30) return fail(L"неверный заголовок блока");
+
+        uint8_t codeLengths[19] = { 0 };
+        for (int i = 0; i < codeLengthCount; ++i) {
+            codeLengths[order[i]] = (uint8_t)reader.read(3);
+        }
+        HuffmanTable codeLengthTable;
+        if (!codeLengthTable.build(codeLengths, 19)) return fail(L"неверный код длин");
+
+        uint8_t lengths[286 + 30] = { 0 };
+        int total = literalCount + distanceCount;
+        for (int i = 0; i < total;) {
+            int symbol = codeLengthTable.decode(reader);
+            if (symbol < 0 || reader.overrun()) return fail(L"неверный код длин");
+            if (symbol < 16) {
+                lengths[i++] = (uint8_t)symbol;
+                continue;
+            }
+
+            uint8_t repeated = 0;
+            int count = 0;
+            if (symbol == 16) {
+                if (i == 0) return fail(L"повтор длины без предыдущей");
+                repeated = lengths[i - 1];
+                count = 3 + (int)reader.read(2);
+            }
+            else if (symbol == 17) {
+                count = 3 + (int)reader.read(3);
+            }
+            else {
+                count = 11 + (int)reader.read(7);
+            }
+            if (i + count > total) return fail(L"длины кодов выходят за таблицу");
+            std::fill(lengths + i, lengths + i + count, repeated);
+            i += count;
+        }
+        if (lengths[256] == 0) return fail(L"нет кода конца блока");
+
+        HuffmanTable literals, distances;
+        if (!literals.build(lengths, literalCount) || !distances.build(lengths + literalCount, distanceCount)) {
+            return fail(L"неверный код Хаффмана");
+        }
+        return inflateCodes(reader, literals, distances);
+    }
+
+    /**
+     * Распаковывает член gzip, начинающийся в position, и сдвигает position за его концевик
+     */
+    bool inflateMember(size_t& position) {
+        if (size - position < 18 || data[position] != 0x1F || data[position + 1] != 0x8B || data[position + 2] != 8) {
+            return fail(L"неверный заголовок gzip");
+        }
+        uint8_t flags = data[position + 3];
+        size_t offset = position + 10;
+        if (flags & 4) {            // FEXTRA
+            if (size - offset < 2) return fail(L"неверный заголовок gzip");
+            offset += 2 + (data[offset] | (data[offset + 1] << 8));
+        }
+        for (uint8_t textFlag : { (uint8_t)8, (uint8_t)16 }) {    // FNAME, FCOMMENT
+            if (!(flags & textFlag)) continue;
+            while (offset < size && data[offset] != 0) offset++;
+            offset++;
+        }
+        if (flags & 2) offset += 2; // FHCRC
+        if (offset >= size) return fail(L"неверный заголовок gzip");
+
+        crc = 0;
+        memberSize = 0;
+        BitReader reader(data, size, offset);
+        bool lastBlock = false;
+        while (!lastBlock) {
+            lastBlock = reader.read(1) != 0;
+            uint32_t type = reader.read(2);
+            bool inflated = type == 0 ? inflateStored(reader) :
+                type == 1 ? inflateFixed(reader) :
+                type == 2 ? inflateDynamic(reader) : fail(L"неизвестный тип блока");
+            if (!inflated) return false;
+        }
+        if (!flush()) return false;
+
+        reader.alignToByte();
+        size_t trailer = reader.bytePosition();
+        if (trailer > size || size - trailer < 8) return fail(L"файл обрывается до концевика gzip");
+        uint32_t storedCrc = data[trailer] | (data[trailer + 1] << 8) | (data[trailer + 2] << 16) | ((uint32_t)data[trailer + 3] << 24);
+        uint32_t storedSize = data[trailer + 4] | (data[trailer + 5] << 8) | (data[trailer + 6] << 16) | ((uint32_t)data[trailer + 7] << 24);
+        if (storedCrc != crc || storedSize != (uint32_t)memberSize) return fail(L"контрольная сумма не совпадает");
+        position = trailer + 8;
+        return true;
+    }
+
+    /**
+     * Распаковывает все члены файла (склеенные gzip-файлы читаются подряд)
+     */
+    bool run() {
+        size_t position = 0;
+        do {
+            if (!inflateMember(position)) return false;
+        } while (detectCompression(data + position, size - position) == COMPRESSION_GZIP);
+        return true;
+    }
+};
+
+//ОГРАНИЧЕННАЯ ОЧЕРЕДЬ БЛОКОВ ТЕКСТА МЕЖДУ ПОТОКОМ РАСПАКОВКИ И РАЗБОРОМ
+struct TextBlockQueue {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::queue<std::vector<char>> blocks;
+    size_t capacity;
+    bool finished;      // Распаковка завершена (успешно или с ошибкой)
+    bool cancelled;     // Разбор прекращен, распаковка должна остановиться
+
+    explicit TextBlockQueue(size_t blockCapacity) : capacity(blockCapacity), finished(false), cancelled(false) {
+    }
+
+    bool push(const uint8_t* data, size_t size) {
+        std::vector<char> block(data, data + size);
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return cancelled || blocks.size() < capacity; });
+        if (cancelled) return false;
+        blocks.push(std::move(block));
+        changed.notify_all();
+        return true;
+    }
+
+    bool pop(std::vector<char>& block) {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [this] { return finished || !blocks.empty(); });
+        if (blocks.empty()) return false;
+        block = std::move(blocks.front());
+        blocks.pop();
+        changed.notify_all();
+        return true;
+    }
+
+    void finish() {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+        changed.notify_all();
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled = true;
+        changed.notify_all();
+    }
+};
+
+/**
+ * Текст исключения для сообщения об ошибке (распаковки, разбора, задачи)
+ */
+std::wstring describeException(std::exception_ptr failure) {
+    try {
+        std::rethrow_exception(failure);
+    }
+    catch (const std::bad_alloc&) {
+        return L"недостаточно памяти";
+    }
+    catch (const std::exception& error) {
+        return utf8_to_wstring(error.what());
+    }
+    catch (...) {
+        return L"неизвестная ошибка";
+    }
+}
+
+/**
+ * Разбор сжатого gzip CSV: распаковка идет в отдельном потоке, разбор получает блоки текста через
+ * ограниченную очередь и обрабатывает полные записи каждого блока (незавершенная запись переносится
+ * в следующий). В памяти одновременно не больше INFLATE_QUEUE_BLOCKS блоков и окно распаковки
+ */
+bool parseGzipCSV(const uint8_t* data, size_t size, LoadedDataset& dataset, std::wstring& errorTitle,
+    std::wstring& error) {
+    TextBlockQueue queue(INFLATE_QUEUE_BLOCKS);
+    GzipInflater inflater(data, size, [&queue](const uint8_t* text, size_t length) {
+        return queue.push(text, length);
+    });
+
+    std::thread decompressor([&] {
+        try {
+            inflater.run();
+        }
+        catch (const std::bad_alloc&) {
+            inflater.fail(L"недостаточно памяти");
+        }
+        catch (...) {
+            inflater.fail(describeException(std::current_exception()));
+        }
+        queue.finish();
+    });
+
+    std::vector<CSVChunk> chunks;
+    std::vector<uint8_t> labelColumns;
+    std::vector<char> text;     // Перенесенная незавершенная запись и новый блок
+    std::vector<char> block;
+    bool delimiterDetected = false;
+    bool headerRead = false;
+    bool parsed = true;
+
+    try {
+        bool more = true;
+        while (more) {
+            more = queue.pop(block);
+            text.insert(text.end(), block.begin(), block.end());
+            block.clear();
+            if (!delimiterDetected) {
+                if (more && text.empty()) continue;
+                dataset.delimiter = detectDelimiter(text.data(), text.size());
+                delimiterDetected = true;
+            }
+
+            size_t end = more ? findLastCSVRecordEnd(text.data(), text.size()) : text.size();
+            size_t position = 0;
+            if (!headerRead) {
+                headerRead = readCSVHeader(text.data(), position, end, dataset, labelColumns);
+            }
+            if (headerRead && position < end) {
+                CSVChunk chunk;
+                chunk.begin = position;
+                chunk.end = end;
+                parseCSVChunk(text.data(), dataset.delimiter, labelColumns, chunk);
+                chunks.push_back(std::move(chunk));
+                position = end;
+            }
+            text.erase(text.begin(), text.begin() + position);
+        }
+    }
+    catch (const std::bad_alloc&) {
+        errorTitle = L"Ошибка";
+        error = L"Недостаточно памяти для разбора файла";
+        parsed = false;
+    }
+    catch (...) {
+        errorTitle = L"Ошибка";
+        error = L"Ошибка разбора файла: " + describeException(std::current_exception());
+        parsed = false;
+    }
+    queue.cancel();
+    decompressor.join();
+
+    if (!inflater.error.empty()) {
+        errorTitle = L"Ошибка распаковки";
+        error = L"Не удалось распаковать gzip: " + inflater.error;
+        return false;
+    }
+    if (!parsed) {
+        return false;
+    }
+    if (!headerRead) {
+        errorTitle = L"Ошибка";
+        error = L"Файл не содержит заголовков!";
+        return false;
+    }
+    return assembleCSVColumns(chunks, labelColumns, dataset, errorTitle, error);
+}
+
+/**
+ * ГЛАВНАЯ ИСПРАВЛЕННАЯ ФУНКЦИЯ: Парсинг CSV. Файл отображается в память и разбирается по блокам
+ * в несколько потоков, сжатый gzip - распаковывается потоково; текст ошибки возвращается
+ * в errorTitle/error (диалоги показывает вызывающий код)
+ */
+bool parseCSV(const std::wstring& filename, LoadedDataset& dataset, std::wstring& errorTitle, std::wstring& error) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        // Пустой файл не отображается в память, но открывается
+        std::ifstream probe(filename, std::ios::binary);
+        if (probe.is_open()) {
+            errorTitle = L"Ошибка";
+            error = L"Файл не содержит заголовков!";
+            return false;
+        }
+        // Дополнительная диагностика
+        error = L"Не удалось открыть файл:\n" + filename +
+            L"\n\nПроверьте:\n• Существует ли файл\n• Нет ли русских символов в пути\n• Файл не заблокирован другой программой";
+        errorTitle = L"Ошибка открытия файла";
+        return false;
+    }
+
+    switch (detectCompression(file.data, (size_t)file.size)) {
+    case COMPRESSION_GZIP:
+        return parseGzipCSV(file.data, (size_t)file.size, dataset, errorTitle, error);
+    case COMPRESSION_ZSTD:
+        errorTitle = L"Ошибка";
+        error = L"Сжатие zstd не поддерживается.\nРаспакуйте файл или сожмите его gzip.";
+        return false;
+    default:
+        break;
+    }
+
+    // Сначала определяем разделитель
+    dataset.delimiter = detectDelimiter((const char*)file.data, (size_t)file.size);
+    return parseCSVBuffer((const char*)file.data, (size_t)file.size, dataset, errorTitle, error);
+}
+
+/**
+ * Загружает набор данных в dataset: из актуального кэша, иначе разбором CSV с записью нового кэша.
+ * Не обращается к глобальным переменным (используется и пакетными заданиями в рабочих потоках)
+ */
+bool loadDatasetFile(const std::wstring& filename, LoadedDataset& dataset, bool& loadedFromCache,
+    std::wstring& errorTitle, std::wstring& error) {
+    loadedFromCache = false;
+
+    DatasetCacheKey key;
+    bool haveKey = computeDatasetCacheKey(filename, key);
+    if (haveKey && loadDatasetCache(filename, key, dataset)) {
+        loadedFromCache = true;
+        return true;
+    }
+
+    if (!parseCSV(filename, dataset, errorTitle, error)) {
+        return false;
+    }
+
+    if (haveKey) {
+        saveDatasetCache(filename, key, dataset);
+    }
+    return true;
+}
+
+/**
+ * Загружает файл для интерфейса: сообщения в диалогах, при успехе набор становится текущим
+ */
+bool loadDataset(const std::wstring& filename, bool& loadedFromCache) {
+    LoadedDataset dataset;
+    std::wstring errorTitle, error;
+    bool loaded = loadDatasetFile(filename, dataset, loadedFromCache, errorTitle, error);
+
+    // Диагностика заголовков
+    if (!loadedFromCache && !dataset.columnNames.empty()) {
+        std::wstring debugInfo = L"Файл успешно открыт!\n\n";
+        MessageBox(hMainWindow, debugInfo.c_str(), L"Диагностика CSV", MB_OK | MB_ICONINFORMATION);
+    }
+    if (!loaded) {
+        MessageBox(hMainWindow, error.c_str(), errorTitle.c_str(), MB_OK | MB_ICONERROR);
+        return false;
+    }
+
+    columnNames.swap(dataset.columnNames);
+    typedColumns.swap(dataset.columns);
+    rowCount = dataset.rowCount;
+    detectedDelimiter = dataset.delimiter;
+    return true;
+}
+
+//ДВОИЧНЫЙ ЖУРНАЛ ПОСТРОЕНИЯ: ЗАПИСИ ФИКСИРОВАННОГО РАЗМЕРА, ТЕКСТ ФОРМИРУЕТСЯ ПО ЗАПРОСУ
+
+#define SPLIT_TRACE_INITIAL_RECORDS 65536   // Заранее выделяемый буфер записей
+
+//ТИП СОБЫТИЯ (ПОЛЯ ЗАПИСИ, КОТОРЫЕ ОН ИСПОЛЬЗУЕТ)
+enum TraceEventType {
+    TRACE_NODE,                 // Узел: leftSize - образцов, leftEntropy - энтропия
+    TRACE_LEAF,                 // Лист: attribute - класс, flag - причина (LeafReason)
+    TRACE_SEARCH,               // Начало поиска разделения: leftSize - образцов, leftEntropy - исходная энтропия
+    TRACE_CLASS_COUNT,          // Распределение классов: attribute - класс, leftSize - образцов
+    TRACE_SAMPLED,              // Выборочный поиск: leftSize - выборка, rightSize - строк узла
+    TRACE_CANDIDATE,            // Кандидат выборочного поиска: attribute, диапазон [threshold, maxThreshold]
+    TRACE_ATTRIBUTE,            // Начало перебора порогов атрибута attribute
+    TRACE_ATTRIBUTE_SKIPPED,    // Атрибут пропущен: flag - 0 несоответствие размеров, 1 одно значение
+    TRACE_THRESHOLD,            // Порог: метрики C4.5, размеры и энтропии ветвей; flag - новый лучший
+    TRACE_VERIFIED,             // Сверка с полным перебором: flag - расхождение
+    TRACE_BEST_SPLIT,           // Итог поиска: flag - разделение найдено, поля - как у TRACE_THRESHOLD
+    TRACE_INTERNAL,             // Внутренний узел: attribute, threshold, gainRatio
+    TRACE_CHILD,                // Начало поддерева: flag - 0 левое, 1 правое
+    TRACE_BLANK_LINE            // Пустая строка после списка
+};
+
+//ПРИЧИНА ОСТАНОВКИ В ЛИСТЕ
+enum LeafReason {
+    LEAF_PURE,
+    LEAF_FEW_SAMPLES,
+    LEAF_MAX_DEPTH,
+    LEAF_NO_GAIN
+};
+
+struct TraceRecord {
+    uint8_t type;
+    uint8_t flag;
+    int32_t depth;
+    int32_t nodeId;             // Номер узла в прямом порядке обхода
+    int32_t attribute;
+    int32_t leftSize;
+    int32_t rightSize;
+    double threshold;
+    double maxThreshold;
+    double informationGain;
+    double splitInformation;
+    double gainRatio;
+    double leftEntropy;
+    double rightEntropy;
+};
+
+struct SplitTrace {
+    std::vector<TraceRecord> records;
+    int nodeCount;
+
+    SplitTrace() : nodeCount(0) {
+        records.reserve(SPLIT_TRACE_INITIAL_RECORDS);
+    }
+
+    int beginNode() {
+        return nodeCount++;
+    }
+
+    TraceRecord& append(TraceEventType type, int nodeId, int depth) {
+        records.emplace_back();
+        TraceRecord& record = records.back();
+        memset(&record, 0, sizeof(record));
+        record.type = (uint8_t)type;
+        record.nodeId = nodeId;
+        record.depth = depth;
+        return record;
+    }
+};
+
+/**
+ * Граница диапазона порогов; открытая граница (нет соседнего кандидата) выводится как −∞ или +∞
+ */
+void renderThresholdBound(double value, std::wostringstream& out) {
+    if (std::isinf(value)) {
+        out << (value < 0 ? L"−∞" : L"+∞");
+    }
+    else {
+        out << std::fixed << std::setprecision(2) << value;
+    }
+}
+
+void renderTraceRecord(const TraceRecord& record, const std::vector<std::string>& names, std::wostringstream& out) {
+    std::wstring indent = std::wstring(record.depth * 2, L' ');
+
+    switch (record.type) {
+    case TRACE_NODE:
+        out << indent << L"УЗЕЛ НА ГЛУБИНЕ " << record.depth << L":\n";
+        out << indent << L"Образцов: " << record.leftSize << L"\n";
+        out << indent << L"Энтропия: "
+            << std::fixed << std::setprecision(4) << record.leftEntropy << L"\n";
+        break;
+
+    case TRACE_LEAF:
+        out << indent << L"ЛИСТ: Предсказанный класс = " << record.attribute;
+        switch (record.flag) {
+        case LEAF_PURE: out << L" (чистое разделение)\n"; break;
+        case LEAF_FEW_SAMPLES: out << L" (недостаточно образцов)\n"; break;
+        case LEAF_MAX_DEPTH: out << L" (достигнута максимальная глубина)\n"; break;
+        default: out << L" (нет улучшения по Gain Ratio)\n"; break;
+        }
+        break;
+
+    case TRACE_SEARCH:
+        out << indent << L"=== ПОИСК ЛУЧШЕГО РАЗДЕЛЕНИЯ ===\n";
+        out << indent << L"Глубина: " << record.depth << L"\n\n";
+        out << indent << L"Исходная энтропия: "
+            << std::fixed << std::setprecision(4) << record.leftEntropy << L"\n";
+        out << indent << L"Количество образцов: " << record.leftSize << L"\n";
+        out << indent << L"Распределение классов:\n";
+        break;
+
+    case TRACE_CLASS_COUNT:
+        out << indent << L"  класс " << record.attribute
+            << L": " << record.leftSize << L" образцов\n";
+        break;
+
+    case TRACE_SAMPLED:
+        out << indent << L"Выборочный поиск: выборка " << record.leftSize << L" из "
+            << record.rightSize << L" строк, кандидаты для точного перебора:\n";
+        break;
+
+    case TRACE_CANDIDATE:
+        out << indent << L"  " << utf8_to_wstring(names[record.attribute]) << L": пороги от ";
+        renderThresholdBound(record.threshold, out);
+        out << L" до ";
+        renderThresholdBound(record.maxThreshold, out);
+        out << L"\n";
+        break;
+
+    case TRACE_ATTRIBUTE:
+        out << indent << L"--- Анализ атрибута: "
+            << utf8_to_wstring(names[record.attribute]) << L" ---\n";
+        break;
+
+    case TRACE_ATTRIBUTE_SKIPPED:
+        out << indent << (record.flag ? L"Недостаточно уникальных значений\n\n" :
+            L"Ошибка: несоответствие размеров данных\n\n");
+        break;
+
+    case TRACE_THRESHOLD:
+        out << indent << L"Порог " << std::fixed << std::setprecision(2) << record.threshold << L":\n";
+        out << indent << L"  Information Gain = " << std::fixed << std::setprecision(4) << record.informationGain << L"\n";
+        out << indent << L"  Split Information = " << std::fixed << std::setprecision(4) << record.splitInformation << L"\n";
+        out << indent << L"  Gain Ratio = " << std::fixed << std::setprecision(4) << record.gainRatio << L"\n";
+        out << indent << L"  Левая ветвь: " << record.leftSize << L" образцов (энтропия: "
+            << std::fixed << std::setprecision(4) << record.leftEntropy << L")\n";
+        out << indent << L"  Правая ветвь: " << record.rightSize << L" образцов (энтропия: "
+            << std::fixed << std::setprecision(4) << record.rightEntropy << L")\n";
+        if (record.flag) {
+            out << indent << L"  !!!НОВЫЙ ЛУЧШИЙ РЕЗУЛЬТАТ!!!\n";
+        }
+        out << L"\n";
+        break;
+
+    case TRACE_VERIFIED:
+        out << indent << (record.flag ?
+            L"Сверка: полный перебор выбрал бы другое разбиение\n" : L"Сверка: совпадает с полным перебором\n");
+        break;
+
+    case TRACE_BEST_SPLIT:
+        if (!record.flag) {
+            out << indent << L"Не найдено подходящего разделения\n";
+            break;
+        }
+        out << indent << L"ЛУЧШЕЕ РАЗДЕЛЕНИЕ:\n";
+        out << indent << L"Атрибут: "
+            << utf8_to_wstring(names[record.attribute]) << L"\n";
+        out << indent << L"Порог: "
+            << std::fixed << std::setprecision(2) << record.threshold << L"\n";
+        out << indent << L"Information Gain: "
+            << std::fixed << std::setprecision(4) << record.informationGain << L"\n";
+        out << indent << L"Split Information: "
+            << std::fixed << std::setprecision(4) << record.splitInformation << L"\n";
+        out << indent << L"Gain Ratio: "
+            << std::fixed << std::setprecision(4) << record.gainRatio << L"\n";
+        out << indent << L"Левая ветвь: " << record.leftSize
             << L" образцов, энтропия: "
-            << std::fixed << std::setprecision(4) << calculateEntropy(result.leftY) << L"\n";
-        steps << indent << L"Правая ветвь: " << result.rightY.size()
+            << std::fixed << std::setprecision(4) << record.leftEntropy << L"\n";
+        out << indent << L"Правая ветвь: " << record.rightSize
             << L" образцов, энтропия: "
-            << std::fixed << std::setprecision(4) << calculateEntropy(result.rightY) << L"\n";
+            << std::fixed << std::setprecision(4) << record.rightEntropy << L"\n";
+        break;
+
+    case TRACE_INTERNAL:
+        out << indent << L"ВНУТРЕННИЙ УЗЕЛ:\n";
+        out << indent << L"Условие: " << utf8_to_wstring(names[record.attribute])
+            << L" < " << std::fixed << std::setprecision(2) << record.threshold << L"\n";
+        out << indent << L"Gain Ratio: " << std::fixed << std::setprecision(4) << record.gainRatio << L"\n\n";
+        break;
+
+    case TRACE_CHILD:
+        out << indent << (record.flag ? L"СТРОИМ ПРАВОЕ ПОДДЕРЕВО:\n" : L"СТРОИМ ЛЕВОЕ ПОДДЕРЕВО:\n");
+        break;
+
+    case TRACE_BLANK_LINE:
+        out << L"\n";
+        break;
+    }
+}
+
+/**
+ * Текст журнала построения для узлов nodeIds (пусто - для всех узлов).
+ * names - названия столбцов файла, на котором строилось дерево
+ */
+std::wstring renderSplitTrace(const SplitTrace& trace, const std::vector<std::string>& names,
+    const std::vector<int>& nodeIds = std::vector<int>()) {
+    std::vector<uint8_t> selected;
+    if (!nodeIds.empty()) {
+        selected.assign(trace.nodeCount, 0);
+        for (int id : nodeIds) {
+            if (id >= 0 && id < trace.nodeCount) selected[id] = 1;
+        }
+    }
+
+    std::wostringstream out;
+    for (const TraceRecord& record : trace.records) {
+        if (selected.empty() || selected[record.nodeId]) {
+            renderTraceRecord(record, names, out);
+        }
+    }
+    return out.str();
+}
+
+//СТРУКТУРА ДЛЯ РЕЗУЛЬТАТА ПОИСКА РАЗДЕЛЕНИЯ C4.5
+struct SplitResult {
+    int bestAttributeIndex;
+    double bestThreshold;
+    double bestInformationGain;
+    double bestSplitInformation;
+    double bestGainRatio;
+
+    std::vector<int> leftIndices;
+    std::vector<int> rightIndices;
+    std::vector<int> leftY;
+    std::vector<int> rightY;
+
+    bool usedSampledSearch;     // Кандидаты отобраны по выборке строк
+    bool sampledSearchVerified; // Выбор сверен с полным перебором
+    bool sampledSearchMismatch; // Полный перебор выбрал бы другое разбиение
+};
+
+//КАНДИДАТ ВЫБОРОЧНОГО ПОИСКА: АТРИБУТ И ДИАПАЗОН ПОРОГОВ ДЛЯ ТОЧНОГО УТОЧНЕНИЯ
+struct SampledCandidate {
+    size_t attribute;           // Позиция в numericColumns
+    double minThreshold;
+    double maxThreshold;
+    double sampleGainRatio;
+};
+
+//СТАТИСТИКА ВЫБОРОЧНОГО ПОИСКА ЗА ПОСЛЕДНЕЕ ПОСТРОЕНИЕ ДЕРЕВА
+struct SampledSearchStats {
+    int sampledNodes;
+    int verifiedNodes;
+    int mismatchedNodes;
+
+    SampledSearchStats() : sampledNodes(0), verifiedNodes(0), mismatchedNodes(0) {}
+};
+
+SampledSearchStats sampledSearchStats;
+
+std::vector<SampledCandidate> shortlistBySample(const DataSubset& data, const TrainingParams& params, int depth);
+bool exactSplitBySweep(const DataSubset& data, int& attribute, double& threshold);
+int buildSubsetClasses(const DataSubset& data, std::vector<int>& rowClass);
+
+/**
+ * Перебор порогов одного атрибута. Шаблон по числу классов K (см. dispatchClassCount) и типу хранения
+ * столбца. Строки узла сортируются по значению один раз, пороги перебираются одним проходом
+ * с накоплением счетчиков классов слева (для двух классов - одного счетчика класса 1);
+ * списки строк ветвей строятся только для лучшего порога атрибута
+ */
+template<int K, typename T>
+void searchAttributeSplits(const std::vector<T>& attributeValues, const DataSubset& data,
+    const std::vector<int>& rowClass, int classCount, int columnIndex,
+    double originalEntropy, SplitTrace& trace, int nodeId, int depth, SplitResult& result,
+    double minThreshold = -HUGE_VAL, double maxThreshold = HUGE_VAL) {
+
+    if (attributeValues.size() != data.yValues.size()) {
+        trace.append(TRACE_ATTRIBUTE_SKIPPED, nodeId, depth).flag = 0;
+        return;
+    }
+
+    int totalSize = (int)attributeValues.size();
+    std::vector<std::pair<T, int>> sortedRows(totalSize);
+    for (int j = 0; j < totalSize; ++j) {
+        sortedRows[j] = std::make_pair(attributeValues[j], rowClass[j]);
+    }
+    std::sort(sortedRows.begin(), sortedRows.end(),
+        [](const std::pair<T, int>& a, const std::pair<T, int>& b) { return a.first < b.first; });
+
+    if (totalSize == 0 || sortedRows.front().first == sortedRows.back().first) {
+        trace.append(TRACE_ATTRIBUTE_SKIPPED, nodeId, depth).flag = 1;
+        return;
+    }
+
+    const int classes = K > 0 ? K : classCount;
+    ClassCounts<K> nodeCounts(classCount), left(classCount), leftBeforeGroup(classCount), right(classCount);
+    for (int j = 0; j < totalSize; ++j) {
+        nodeCounts.data()[rowClass[j]]++;
+    }
+
+    //ПЕРЕБОР ВСЕХ ВОЗМОЖНЫХ ПОРОГОВ (СЕРЕДИНЫ СОСЕДНИХ УНИКАЛЬНЫХ ЗНАЧЕНИЙ)
+    bool improved = false;
+    int positive = 0;
+    int seen = 0;
+    int i = 0;
+    while (i < totalSize) {
+        T groupValue = sortedRows[i].first;
+        int groupStart = seen;
+        if (K == 2) {
+            leftBeforeGroup.data()[0] = groupStart - positive;
+            leftBeforeGroup.data()[1] = positive;
+            while (i < totalSize && sortedRows[i].first == groupValue) {
+                positive += sortedRows[i].second;
+                i++;
+            }
+            seen = i;
+            left.data()[0] = seen - positive;
+            left.data()[1] = positive;
+        }
+        else {
+            std::copy(left.data(), left.data() + classes, leftBeforeGroup.data());
+            while (i < totalSize && sortedRows[i].first == groupValue) {
+                left.data()[sortedRows[i].second]++;
+                i++;
+            }
+            seen = i;
+        }
+        if (i == totalSize) break;
+
+        double lower = (double)groupValue;
+        double upper = (double)sortedRows[i].first;
+        double threshold = (lower + upper) / 2.0;
+        if (threshold < minThreshold || threshold > maxThreshold) continue;
+
+        // Слева - значения строго меньше порога: если середина при округлении совпала
+        // с lower, группа lower уходит вправо
+        const int* leftCounts;
+        int leftSize;
+        if (threshold > lower && threshold <= upper) {
+            leftCounts = left.data();
+            leftSize = seen;
+        }
+        else if (threshold == lower) {
+            leftCounts = leftBeforeGroup.data();
+            leftSize = groupStart;
+        }
+        else {
+            continue; // Переполнение при вычислении порога: одна из ветвей пуста
+        }
+        int rightSize = totalSize - leftSize;
+        if (leftSize == 0 || rightSize == 0) continue;
+
+        for (int c = 0; c < classes; ++c) {
+            right.data()[c] = nodeCounts.data()[c] - leftCounts[c];
+        }
+
+        //ВЫЧИСЛЕНИЕ МЕТРИК C4.5
+        double leftEntropy = entropyOfCounts<K>(leftCounts, classCount, leftSize);
+        double rightEntropy = entropyOfCounts<K>(right.data(), classCount, rightSize);
+
+        // Information Gain
+        double weightedEntropy = ((double)leftSize / totalSize) * leftEntropy +
+            ((double)rightSize / totalSize) * rightEntropy;
+        double informationGain = originalEntropy - weightedEntropy;
+
+        // Split Information
+        double splitInformation = calculateSplitInformation(leftSize, rightSize);
+
+        // Gain Ratio
+        double gainRatio = calculateGainRatio(informationGain, splitInformation);
+
+        // Подробное логирование (запись фиксированного размера, текст - при выводе отчета)
+        TraceRecord& record = trace.append(TRACE_THRESHOLD, nodeId, depth);
+        record.attribute = columnIndex;
+        record.threshold = threshold;
+        record.informationGain = informationGain;
+        record.splitInformation = splitInformation;
+        record.gainRatio = gainRatio;
+        record.leftSize = leftSize;
+        record.rightSize = rightSize;
+        record.leftEntropy = leftEntropy;
+        record.rightEntropy = rightEntropy;
+
+        if (gainRatio > result.bestGainRatio) {
+            result.bestGainRatio = gainRatio;
+            result.bestInformationGain = informationGain;
+            result.bestSplitInformation = splitInformation;
+            result.bestAttributeIndex = columnIndex;
+            result.bestThreshold = threshold;
+            improved = true;
+
+            record.flag = 1;
+        }
+    }
+
+    //СТРОКИ ВЕТВЕЙ ЛУЧШЕГО ПОРОГА АТРИБУТА (В ИСХОДНОМ ПОРЯДКЕ)
+    if (!improved) return;
+    result.leftIndices.clear();
+    result.rightIndices.clear();
+    result.leftY.clear();
+    result.rightY.clear();
+    for (int j = 0; j < totalSize; ++j) {
+        if ((double)attributeValues[j] < result.bestThreshold) {
+            result.leftIndices.push_back(data.originalRowIndices[j]);
+            result.leftY.push_back(data.yValues[j]);
+        }
+        else {
+            result.rightIndices.push_back(data.originalRowIndices[j]);
+            result.rightY.push_back(data.yValues[j]);
+        }
+    }
+}
+
+//ОСНОВНАЯ ФУНКЦИЯ ПОИСКА ЛУЧШЕГО РАЗДЕЛЕНИЯ C4.5
+SplitResult findBestSplit(const DataSubset& data, const std::vector<int>& numericColumns, int depth,
+    const TrainingParams& params, SplitTrace& trace, int nodeId) {
+    MemoryCategoryScope memoryScope(MEM_SPLIT_RESULT);
+    SplitResult result;
+    result.bestGainRatio = -1.0;
+    result.bestInformationGain = -1.0;
+    result.bestSplitInformation = 0.0;
+    result.bestAttributeIndex = -1;
+    result.usedSampledSearch = false;
+    result.sampledSearchVerified = false;
+    result.sampledSearchMismatch = false;
+
+    double originalEntropy = calculateEntropy(data.yValues);
+    TraceRecord& header = trace.append(TRACE_SEARCH, nodeId, depth);
+    header.leftEntropy = originalEntropy;
+    header.leftSize = (int)data.yValues.size();
+
+    // Распределение классов
+    std::map<int, int> classCounts;
+    for (int y : data.yValues) {
+        classCounts[y]++;
+    }
+    for (const auto& pair : classCounts) {
+        TraceRecord& record = trace.append(TRACE_CLASS_COUNT, nodeId, depth);
+        record.attribute = pair.first;
+        record.leftSize = pair.second;
+    }
+    trace.append(TRACE_BLANK_LINE, nodeId, depth);
+
+    //ОТБОР КАНДИДАТОВ ПО ВЫБОРКЕ ДЛЯ БОЛЬШИХ УЗЛОВ
+    std::vector<SampledCandidate> candidates;
+    if (params.sampledSearchMinRows > 0 && (int)data.yValues.size() >= params.sampledSearchMinRows &&
+        params.sampleSize < (int)data.yValues.size()) {
+        candidates = shortlistBySample(data, params, depth);
+        result.usedSampledSearch = true;
+
+        TraceRecord& sampled = trace.append(TRACE_SAMPLED, nodeId, depth);
+        sampled.leftSize = params.sampleSize;
+        sampled.rightSize = (int)data.yValues.size();
+        for (const SampledCandidate& candidate : candidates) {
+            TraceRecord& record = trace.append(TRACE_CANDIDATE, nodeId, depth);
+            record.attribute = numericColumns[candidate.attribute];
+            record.threshold = candidate.minThreshold;
+            record.maxThreshold = candidate.maxThreshold;
+        }
+        trace.append(TRACE_BLANK_LINE, nodeId, depth);
+    }
+
+    //КОДЫ КЛАССОВ СТРОК УЗЛА: ПО ИХ ЧИСЛУ ВЫБИРАЕТСЯ СПЕЦИАЛИЗАЦИЯ ПЕРЕБОРА ПОРОГОВ
+    std::vector<int> rowClass;
+    int classCount = buildSubsetClasses(data, rowClass);
+
+    //ПЕРЕБОР ВСЕХ АТРИБУТОВ (ИЛИ ТОЛЬКО КАНДИДАТОВ В ИХ ДИАПАЗОНАХ ПОРОГОВ)
+    size_t nextCandidate = 0;
+    for (size_t attrIdx = 0; attrIdx < numericColumns.size(); ++attrIdx) {
+        double minThreshold = -HUGE_VAL, maxThreshold = HUGE_VAL;
+        if (result.usedSampledSearch) {
+            if (nextCandidate == candidates.size() || candidates[nextCandidate].attribute != attrIdx) continue;
+            minThreshold = candidates[nextCandidate].minThreshold;
+            maxThreshold = candidates[nextCandidate].maxThreshold;
+            nextCandidate++;
+        }
+
+        int columnIndex = numericColumns[attrIdx];
+        trace.append(TRACE_ATTRIBUTE, nodeId, depth).attribute = columnIndex;
+
+        dispatchClassCount(classCount, [&](auto classes) {
+            dispatchStorage(data.attributeValues[attrIdx], [&](const auto& attributeValues) {
+                searchAttributeSplits<decltype(classes)::value>(attributeValues, data, rowClass, classCount,
+                    columnIndex, originalEntropy, trace, nodeId, depth, result, minThreshold, maxThreshold);
+            });
+        });
+    }
+
+    //СВЕРКА С ПОЛНЫМ ПЕРЕБОРОМ
+    if (result.usedSampledSearch && params.verifySampledSearch) {
+        int fullAttribute = -1;
+        double fullThreshold = 0.0;
+        bool fullFound = exactSplitBySweep(data, fullAttribute, fullThreshold);
+        bool sampledFound = result.bestGainRatio > 0;
+
+        result.sampledSearchVerified = true;
+        result.sampledSearchMismatch = fullFound != sampledFound ||
+            (fullFound && (numericColumns[fullAttribute] != result.bestAttributeIndex || fullThreshold != result.bestThreshold));
+        trace.append(TRACE_VERIFIED, nodeId, depth).flag = result.sampledSearchMismatch ? 1 : 0;
+    }
+
+    //ИТОГОВЫЙ РЕЗУЛЬТАТ
+    TraceRecord& best = trace.append(TRACE_BEST_SPLIT, nodeId, depth);
+    if (result.bestGainRatio > 0) {
+        best.flag = 1;
+        best.attribute = result.bestAttributeIndex;
+        best.threshold = result.bestThreshold;
+        best.informationGain = result.bestInformationGain;
+        best.splitInformation = result.bestSplitInformation;
+        best.gainRatio = result.bestGainRatio;
+        best.leftSize = (int)result.leftY.size();
+        best.rightSize = (int)result.rightY.size();
+        best.leftEntropy = calculateEntropy(result.leftY);
+        best.rightEntropy = calculateEntropy(result.rightY);
+    }
+
+    return result;
+}
+
+//РЕКУРСИВНАЯ ФУНКЦИЯ ПОСТРОЕНИЯ ДЕРЕВА C4.5
+std::unique_ptr<DecisionNode> buildDecisionTree(const DataSubset& data, const std::vector<int>& numericColumns,
+    int depth, SplitTrace& trace, const TrainingParams& params) {
+    MemoryCategoryScope memoryScope(MEM_TREE_LOG);
+    int nodeId = trace.beginNode();
+
+    std::unique_ptr<DecisionNode> node;
+    {
+        MemoryCategoryScope nodeScope(MEM_TREE_NODES);
+        node = std::make_unique<DecisionNode>();
+    }
+    node->depth = depth;
+    {
+        MemoryCategoryScope labelScope(MEM_NODE_LABELS);
+        node->labelCounts = countLabels(data.yValues);
+    }
+    node->sampleCount = (int)data.yValues.size();
+    node->entropy = calculateEntropy(data.yValues);
+    node->predictedClass = getMajorityClass(data.yValues);
+
+    TraceRecord& header = trace.append(TRACE_NODE, nodeId, depth);
+    header.leftSize = node->sampleCount;
+    header.leftEntropy = node->entropy;
+
+    //УСЛОВИЯ ОСТАНОВКИ
+    if (node->entropy == 0.0 || (int)data.yValues.size() < params.minSamplesSplit || depth >= params.maxDepth) {
+        node->isLeaf = true;
+        TraceRecord& leaf = trace.append(TRACE_LEAF, nodeId, depth);
+        leaf.attribute = node->predictedClass;
+
+        if (node->entropy == 0.0) {
+            leaf.flag = LEAF_PURE;
+        }
+        else if ((int)data.yValues.size() < params.minSamplesSplit) {
+            leaf.flag = LEAF_FEW_SAMPLES;
+        }
+        else {
+            leaf.flag = LEAF_MAX_DEPTH;
+        }
+
+        {
+            MemoryCategoryScope nodeScope(MEM_TREE_NODES);
+            node->nodeDescription = L"Лист: класс " + std::to_wstring(node->predictedClass);
+        }
+        return node;
+    }
+
+    //ПОИСК ЛУЧШЕГО РАЗДЕЛЕНИЯ ПО C4.5
+    SplitResult split = findBestSplit(data, numericColumns, depth, params, trace, nodeId);
+    if (split.usedSampledSearch) {
+        sampledSearchStats.sampledNodes++;
+        if (split.sampledSearchVerified) sampledSearchStats.verifiedNodes++;
+        if (split.sampledSearchMismatch) sampledSearchStats.mismatchedNodes++;
+    }
+
+    if (split.bestGainRatio <= 0) {
+        node->isLeaf = true;
+        TraceRecord& leaf = trace.append(TRACE_LEAF, nodeId, depth);
+        leaf.attribute = node->predictedClass;
+        leaf.flag = LEAF_NO_GAIN;
+        {
+            MemoryCategoryScope nodeScope(MEM_TREE_NODES);
+            node->nodeDescription = L"Лист: класс " + std::to_wstring(node->predictedClass);
+        }
+        return node;
+    }
+
+    //СОЗДАНИЕ ВНУТРЕННЕГО УЗЛА
+    node->attributeIndex = split.bestAttributeIndex;
+    node->threshold = split.bestThreshold;
+    node->informationGain = split.bestInformationGain;
+    node->splitInformation = split.bestSplitInformation;
+    node->gainRatio = split.bestGainRatio;
+    {
+        MemoryCategoryScope nodeScope(MEM_TREE_NODES);
+        node->attributeName = columnNames[split.bestAttributeIndex];
+        node->nodeDescription = utf8_to_wstring(node->attributeName) + L" < " +
+            std::to_wstring(node->threshold).substr(0, 5);
+    }
+
+    TraceRecord& internal = trace.append(TRACE_INTERNAL, nodeId, depth);
+    internal.attribute = node->attributeIndex;
+    internal.threshold = node->threshold;
+    internal.gainRatio = node->gainRatio;
+
+    //РЕКУРСИВНОЕ ПОСТРОЕНИЕ ПОДДЕРЕВЬЕВ
+    if (!split.leftY.empty()) {
+        trace.append(TRACE_CHILD, nodeId, depth).flag = 0;
+        DataSubset leftData = createDataSubset(split.leftIndices,
+            std::find(columnNames.begin(), columnNames.end(), "Y") - columnNames.begin(),
+            numericColumns);
+        node->leftChild = buildDecisionTree(leftData, numericColumns, depth + 1, trace, params);
+    }
+
+    if (!split.rightY.empty()) {
+        trace.append(TRACE_CHILD, nodeId, depth).flag = 1;
+        DataSubset rightData = createDataSubset(split.rightIndices,
+            std::find(columnNames.begin(), columnNames.end(), "Y") - columnNames.begin(),
+            numericColumns);
+        node->rightChild = buildDecisionTree(rightData, numericColumns, depth + 1, trace, params);
+    }
+
+    return node;
+}
+
+//ОБРЕЗКА ДЕРЕВА ПО ОЦЕНКЕ ОШИБКИ C4.5 (ЗАМЕНА ПОДДЕРЕВА ЛИСТОМ)
+
+/**
+ * Верхняя граница числа ошибок сверх наблюдаемых e среди n образцов
+ * при уровне доверия confidence (функция AddErrs из C4.5)
+ */
+double estimateAddedErrors(double n, double e, double confidence) {
+    static const double confidenceLevels[] = { 0.0, 0.001, 0.005, 0.01, 0.05, 0.10, 0.20, 0.40, 1.00 };
+    static const double deviations[] = { 4.0, 3.09, 2.58, 2.33, 1.65, 1.28, 0.84, 0.25, 0.00 };
+
+    if (e < 1e-6) {
+        return n * (1.0 - exp(log(confidence) / n));
+    }
+    if (e < 0.9999) {
+        double zeroErrors = n * (1.0 - exp(log(confidence) / n));
+        return zeroErrors + e * (estimateAddedErrors(n, 1.0, confidence) - zeroErrors);
+    }
+    if (e + 0.5 >= n) {
+        return 0.67 * (n - e);
+    }
+
+    int i = 1;
+    while (i < 8 && confidence > confidenceLevels[i]) i++;
+    double z = deviations[i - 1] + (deviations[i] - deviations[i - 1]) *
+        (confidence - confidenceLevels[i - 1]) / (confidenceLevels[i] - confidenceLevels[i - 1]);
+    double coeff = z * z;
+
+    double upper = (e + 0.5 + coeff / 2 + sqrt(coeff * ((e + 0.5) * (1 - (e + 0.5) / n) + coeff / 4))) / (n + coeff);
+    return n * upper - e;
+}
+
+/**
+ * Возвращает оценку числа ошибок поддерева; заменяет поддерево листом,
+ * если оценка для листа не хуже
+ */
+double pruneDecisionTree(DecisionNode* node, double confidence) {
+    int majorityCount = 0;
+    int total = 0;
+    for (const auto& pair : node->labelCounts) {
+        majorityCount = std::max(majorityCount, pair.second);
+        total += pair.second;
+    }
+
+    double n = (double)total;
+    double leafErrors = n - majorityCount;
+    double leafEstimate = n > 0 ? leafErrors + estimateAddedErrors(n, leafErrors, confidence) : 0.0;
+
+    if (node->isLeaf) {
+        return leafEstimate;
+    }
+
+    double subtreeEstimate = 0.0;
+    if (node->leftChild) subtreeEstimate += pruneDecisionTree(node->leftChild.get(), confidence);
+    if (node->rightChild) subtreeEstimate += pruneDecisionTree(node->rightChild.get(), confidence);
+
+    if (leafEstimate <= subtreeEstimate + 0.1) {
+        node->isLeaf = true;
+        node->leftChild.reset();
+        node->rightChild.reset();
+        node->nodeDescription = L"Лист: класс " + std::to_wstring(node->predictedClass);
+        return leafEstimate;
+    }
+    return subtreeEstimate;
+}
+
+//ФУНКЦИЯ ВИЗУАЛИЗАЦИИ ДЕРЕВА C4.5
+std::wstring printTree(const DecisionNode* node, const std::wstring& prefix = L"", bool isLast = true) {
+    if (!node) return L"";
+
+    std::wostringstream result;
+    result << prefix;
+    result << (isLast ? L"└── " : L"├── ");
+
+    if (node->isLeaf) {
+        result << L"ЛИСТ: Класс " << node->predictedClass << L"\n";
+        result << prefix << (isLast ? L"    " : L"│   ")
+            << L"(энтропия: " << std::fixed << std::setprecision(4) << node->entropy
+            << L", образцов: " << node->sampleCount << L")\n";
+    }
+    else {
+        result << utf8_to_wstring(node->attributeName) << L" < "
+            << std::fixed << std::setprecision(2) << node->threshold << L"\n";
+        result << prefix << (isLast ? L"    " : L"│   ")
+            << L"(Gain Ratio: " << std::fixed << std::setprecision(4) << node->gainRatio
+            << L", IG: " << std::fixed << std::setprecision(4) << node->informationGain << L")\n";
+
+        std::wstring newPrefix = prefix + (isLast ? L"    " : L"│   ");
+        if (node->leftChild) {
+            result << printTree(node->leftChild.get(), newPrefix, !node->rightChild);
+        }
+        if (node->rightChild) {
+            result << printTree(node->rightChild.get(), newPrefix, true);
+        }
+    }
+
+    return result.str();
+}
+
+//ПРЕДСКАЗАНИЕ КЛАССОВ ДЛЯ СТРОК ЗАГРУЖЕННЫХ ДАННЫХ
+
+/**
+ * Разделение строк по порогу узла. Шаблон по типу хранения столбца
+ */
+template<typename T>
+void partitionRowsByThreshold(const std::vector<T>& values, double threshold, const std::vector<int>& rows,
+    std::vector<int>& leftRows, std::vector<int>& rightRows) {
+    for (int row : rows) {
+        if ((double)values[row] < threshold) {
+            leftRows.push_back(row);
+        }
+        else {
+            rightRows.push_back(row);
+        }
+    }
+}
+
+void predictRowsAtNode(const DecisionNode* node, const std::vector<ColumnData>& columns, const std::vector<int>& rows,
+    std::vector<int>& predictions) {
+    if (rows.empty()) return;
+
+    if (node->isLeaf || !node->leftChild || !node->rightChild) {
+        for (int row : rows) {
+            predictions[row] = node->predictedClass;
+        }
+        return;
+    }
+
+    std::vector<int> leftRows, rightRows;
+    leftRows.reserve(rows.size());
+    rightRows.reserve(rows.size());
+    dispatchStorage(columns[node->attributeIndex].values, [&](const auto& values) {
+        partitionRowsByThreshold(values, node->threshold, rows, leftRows, rightRows);
+    });
+
+    predictRowsAtNode(node->leftChild.get(), columns, leftRows, predictions);
+    predictRowsAtNode(node->rightChild.get(), columns, rightRows, predictions);
+}
+
+/**
+ * Предсказывает классы для строк rows набора из count строк; результат индексируется номером строки
+ */
+std::vector<int> predictRows(const DecisionNode* root, const std::vector<ColumnData>& columns, size_t count,
+    const std::vector<int>& rows) {
+    std::vector<int> predictions(count, -1);
+    if (root) {
+        predictRowsAtNode(root, columns, rows, predictions);
+    }
+    return predictions;
+}
+
+//ПАКЕТНАЯ ОЦЕНКА АНСАМБЛЯ ДЕРЕВЬЕВ ПО БИТОВЫМ МАСКАМ (QUICKSCORER)
+
+//РЕАЛИЗАЦИЯ ОЦЕНКИ: ВЕКТОРНЫЕ ВАРИАНТЫ ОБРАБАТЫВАЮТ НЕСКОЛЬКО СТРОК ЗА ИНСТРУКЦИЮ
+enum QuickScorerBackend {
+    QS_SCALAR,
+    QS_SSE2,    // 2 строки
+    QS_AVX2     // 4 строки
+};
+
+const wchar_t* quickScorerBackendName(QuickScorerBackend backend) {
+    switch (backend) {
+    case QS_SSE2: return L"SSE2";
+    case QS_AVX2: return L"AVX2";
+    default: return L"скалярная";
+    }
+}
+
+/**
+ * Лучшая доступная реализация: AVX2 требует поддержки и процессором, и ОС (сохранение регистров YMM)
+ */
+QuickScorerBackend detectQuickScorerBackend() {
+    int info[4] = { 0 };
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx = (info[2] & (1 << 28)) != 0;
+    if (maxLeaf >= 7 && osxsave && avx && (_xgetbv(0) & 6) == 6) {
+        __cpuidex(info, 7, 0);
+        if (info[1] & (1 << 5)) {
+            return QS_AVX2;
+        }
+    }
+    return sse2 ? QS_SSE2 : QS_SCALAR;
+}
+
+/**
+ * Номер младшего единичного бита (word != 0)
+ */
+inline unsigned countTrailingZeros(uint64_t word) {
+    unsigned long index = 0;
+#if defined(_M_X64)
+    _BitScanForward64(&index, word);
+    return (unsigned)index;
+#else
+    if (_BitScanForward(&index, (unsigned long)word)) {
+        return (unsigned)index;
+    }
+    _BitScanForward(&index, (unsigned long)(word >> 32));
+    return (unsigned)index + 32;
+#endif
+}
+
+//ПРОВЕРКА УЗЛА: ПРИ value >= threshold (ПЕРЕХОД ВПРАВО) ЛИСТЬЯ ЛЕВОГО ПОДДЕРЕВА ИСКЛЮЧАЮТСЯ
+struct QuickScorerTest {
+    double threshold;
+    uint32_t firstWord;     // Первое слово битовых векторов (сквозная нумерация по деревьям), которое затрагивает маска
+    uint32_t wordCount;
+    uint32_t maskOffset;    // Начало маски в QuickScorer::masks
+};
+
+/**
+ * Листья каждого дерева нумеруются слева направо и образуют битовый вектор.
+ * Проверки всех узлов сгруппированы по признаку и отсортированы по порогу: для значения x
+ * ложны ровно проверки с threshold <= x, и их маски применяются подряд до первого большего порога.
+ * Выходной лист - младший оставшийся бит (самый левый лист, не исключённый ни одним узлом пути)
+ */
+struct QuickScorer {
+    std::vector<int> features;          // Столбцы с проверками; порядок задаёт раскладку строки значений
+    std::vector<size_t> featureBegin;   // Проверки признака f: [featureBegin[f], featureBegin[f + 1])
+    std::vector<QuickScorerTest> tests;
+    std::vector<uint64_t> masks;
+    std::vector<size_t> leafBegin;      // Листья дерева t: [leafBegin[t], leafBegin[t + 1])
+    std::vector<int> leafClasses;
+    std::vector<size_t> wordBegin;      // Слова битового вектора дерева t: [wordBegin[t], wordBegin[t + 1])
+    size_t treeCount;
+    QuickScorerBackend backend;
+
+    QuickScorer() : treeCount(0), backend(QS_SCALAR) {}
+
+    //ПРОВЕРКА ДО РАСКЛАДКИ ПО ПРИЗНАКАМ: ЛИСТЬЯ ЛЕВОГО ПОДДЕРЕВА [firstLeaf, endLeaf)
+    struct PendingTest {
+        int feature;
+        double threshold;
+        uint32_t tree;
+        size_t firstLeaf;
+        size_t endLeaf;
+    };
+
+    void collectTests(const DecisionNode* node, uint32_t tree, std::vector<PendingTest>& pending) {
+        if (node->isLeaf || !node->leftChild || !node->rightChild) {
+            leafClasses.push_back(node->predictedClass);
+            return;
+        }
+        size_t index = pending.size();
+        pending.push_back({ node->attributeIndex, node->threshold, tree, leafClasses.size() - leafBegin.back(), 0 });
+        collectTests(node->leftChild.get(), tree, pending);
+        pending[index].endLeaf = leafClasses.size() - leafBegin.back();
+        collectTests(node->rightChild.get(), tree, pending);
+    }
+
+    void build(const std::vector<const DecisionNode*>& trees) {
+        features.clear();
+        featureBegin.clear();
+        tests.clear();
+        masks.clear();
+        leafBegin.assign(1, 0);
+        leafClasses.clear();
+        wordBegin.assign(1, 0);
+        treeCount = trees.size();
+        backend = detectQuickScorerBackend();
+
+        std::vector<PendingTest> pending;
+        for (size_t t = 0; t < trees.size(); ++t) {
+            collectTests(trees[t], (uint32_t)t, pending);
+            leafBegin.push_back(leafClasses.size());
+            wordBegin.push_back(wordBegin[t] + (leafBegin[t + 1] - leafBegin[t] + 63) / 64);
+        }
+
+        std::stable_sort(pending.begin(), pending.end(), [](const PendingTest& a, const PendingTest& b) {
+            return a.feature != b.feature ? a.feature < b.feature : a.threshold < b.threshold;
+        });
+
+        tests.reserve(pending.size());
+        for (const PendingTest& test : pending) {
+            if (features.empty() || features.back() != test.feature) {
+                features.push_back(test.feature);
+                featureBegin.push_back(tests.size());
+            }
+            size_t firstWord = test.firstLeaf / 64;
+            size_t lastWord = (test.endLeaf - 1) / 64;
+            tests.push_back({ test.threshold, (uint32_t)(wordBegin[test.tree] + firstWord),
+                (uint32_t)(lastWord - firstWord + 1), (uint32_t)masks.size() });
+            for (size_t w = firstWord; w <= lastWord; ++w) {
+                size_t from = std::max(test.firstLeaf, w * 64) - w * 64;
+                size_t to = std::min(test.endLeaf, w * 64 + 64) - w * 64;
+                uint64_t cleared = (to - from == 64) ? ~0ULL : (((1ULL << (to - from)) - 1) << from);
+                masks.push_back(~cleared);
+            }
+        }
+        featureBegin.push_back(tests.size());
+    }
+
+    /**
+     * NaN не меньше никакого порога и идёт вправо, как +inf
+     */
+    static double laneValue(const double* values, size_t row, size_t featureCount, size_t f) {
+        double x = values[row * featureCount + f];
+        return x != x ? HUGE_VAL : x;
+    }
+
+    int exitLeafClass(const uint64_t* bits, size_t tree, size_t lanes, size_t lane) const {
+        for (size_t w = wordBegin[tree]; w < wordBegin[tree + 1]; ++w) {
+            uint64_t word = bits[w * lanes + lane];
+            if (word) {
+                return leafClasses[leafBegin[tree] + (w - wordBegin[tree]) * 64 + countTrailingZeros(word)];
+            }
+        }
+        return leafClasses[leafBegin[tree + 1] - 1];   // Недостижимо: самый правый лист не исключается
+    }
+
+    void scoreScalar(const double* values, size_t count, int* out) const {
+        size_t featureCount = features.size();
+        std::vector<uint64_t> bits(wordBegin.back());
+        for (size_t r = 0; r < count; ++r) {
+            std::fill(bits.begin(), bits.end(), ~0ULL);
+            for (size_t f = 0; f < featureCount; ++f) {
+                double x = laneValue(values, r, featureCount, f);
+                for (size_t i = featureBegin[f]; i < featureBegin[f + 1] && tests[i].threshold <= x; ++i) {
+                    const QuickScorerTest& test = tests[i];
+                    uint64_t* word = &bits[test.firstWord];
+                    const uint64_t* mask = &masks[test.maskOffset];
+                    for (uint32_t w = 0; w < test.wordCount; ++w) {
+                        word[w] &= mask[w];
+                    }
+                }
+            }
+            for (size_t t = 0; t < treeCount; ++t) {
+                out[r * treeCount + t] = exitLeafClass(bits.data(), t, 1, 0);
+            }
+        }
+    }
+
+    /**
+     * Слова битовых векторов чередуются по строкам блока: одна инструкция обновляет слово во всех строках,
+     * маска применяется только в тех строках, где проверка ложна
+     */
+    void scoreSse2(const double* values, size_t count, int* out) const {
+        const size_t lanes = 2;
+        size_t featureCount = features.size();
+        std::vector<uint64_t> bits(wordBegin.back() * lanes);
+        for (size_t r = 0; r < count; r += lanes) {
+            size_t active = std::min(lanes, count - r);
+            std::fill(bits.begin(), bits.end(), ~0ULL);
+            for (size_t f = 0; f < featureCount; ++f) {
+                double x0 = laneValue(values, r, featureCount, f);
+                double x1 = active > 1 ? laneValue(values, r + 1, featureCount, f) : -HUGE_VAL;
+                __m128d x = _mm_set_pd(x1, x0);
+                double xMax = std::max(x0, x1);
+                for (size_t i = featureBegin[f]; i < featureBegin[f + 1] && tests[i].threshold <= xMax; ++i) {
+                    const QuickScorerTest& test = tests[i];
+                    __m128i apply = _mm_castpd_si128(_mm_cmpge_pd(x, _mm_set1_pd(test.threshold)));
+                    __m128i* word = (__m128i*)&bits[test.firstWord * lanes];
+                    for (uint32_t w = 0; w < test.wordCount; ++w) {
+                        __m128i mask = _mm_set1_epi64x((long long)masks[test.maskOffset + w]);
+                        __m128i cleared = _mm_andnot_si128(mask, apply);
+                        _mm_storeu_si128(word + w, _mm_andnot_si128(cleared, _mm_loadu_si128(word + w)));
+                    }
+                }
+            }
+            for (size_t lane = 0; lane < active; ++lane) {
+                for (size_t t = 0; t < treeCount; ++t) {
+                    out[(r + lane) * treeCount + t] = exitLeafClass(bits.data(), t, lanes, lane);
+                }
+            }
+        }
+    }
+
+    void scoreAvx2(const double* values, size_t count, int* out) const {
+        const size_t lanes = 4;
+        size_t featureCount = features.size();
+        std::vector<uint64_t> bits(wordBegin.back() * lanes);
+        double lane[4];
+        for (size_t r = 0; r < count; r += lanes) {
+            size_t active = std::min(lanes, count - r);
+            std::fill(bits.begin(), bits.end(), ~0ULL);
+            for (size_t f = 0; f < featureCount; ++f) {
+                double xMax = -HUGE_VAL;
+                for (size_t l = 0; l < lanes; ++l) {
+                    lane[l] = l < active ? laneValue(values, r + l, featureCount, f) : -HUGE_VAL;
+                    xMax = std::max(xMax, lane[l]);
+                }
+                __m256d x = _mm256_loadu_pd(lane);
+                for (size_t i = featureBegin[f]; i < featureBegin[f + 1] && tests[i].threshold <= xMax; ++i) {
+                    const QuickScorerTest& test = tests[i];
+                    __m256i apply = _mm256_castpd_si256(_mm256_cmp_pd(x, _mm256_set1_pd(test.threshold), _CMP_GE_OQ));
+                    __m256i* word = (__m256i*)&bits[test.firstWord * lanes];
+                    for (uint32_t w = 0; w < test.wordCount; ++w) {
+                        __m256i mask = _mm256_set1_epi64x((long long)masks[test.maskOffset + w]);
+                        __m256i cleared = _mm256_andnot_si256(mask, apply);
+                        _mm256_storeu_si256(word + w, _mm256_andnot_si256(cleared, _mm256_loadu_si256(word + w)));
+                    }
+                }
+            }
+            for (size_t l = 0; l < active; ++l) {
+                for (size_t t = 0; t < treeCount; ++t) {
+                    out[(r + l) * treeCount + t] = exitLeafClass(bits.data(), t, lanes, l);
+                }
+            }
+        }
+    }
+
+    /**
+     * values - count строк по features.size() значений (в порядке features);
+     * out - count строк по treeCount классов выходных листьев
+     */
+    void scoreRows(const double* values, size_t count, int* out) const {
+        if (treeCount == 0 || count == 0) return;
+        switch (backend) {
+        case QS_AVX2: scoreAvx2(values, count, out); break;
+        case QS_SSE2: scoreSse2(values, count, out); break;
+        default: scoreScalar(values, count, out); break;
+        }
+    }
+};
+
+/**
+ * Голосование деревьев ансамбля: большинство, при равенстве - меньший класс
+ */
+int voteEnsembleClasses(const int* classes, size_t count) {
+    if (count == 1) {
+        return classes[0];
+    }
+    std::map<int, size_t> votes;
+    for (size_t t = 0; t < count; ++t) {
+        votes[classes[t]]++;
+    }
+    auto best = votes.begin();
+    for (auto it = votes.begin(); it != votes.end(); ++it) {
+        if (it->second > best->second) best = it;
+    }
+    return best->first;
+}
+
+//ПОДГОТОВЛЕННЫЙ НАБОР ДАННЫХ ДЛЯ МНОГОКРАТНОГО ОБУЧЕНИЯ (СОРТИРОВКА СТОЛБЦОВ ОДИН РАЗ)
+struct PreparedDataset {
+    const std::vector<ColumnData>* columns;     // Столбцы набора (загруженный файл или набор пакетного задания)
+    const std::vector<std::string>* columnNames;
+    size_t rowCount;
+    std::vector<int> attributeColumns;          // Номера числовых столбцов-атрибутов
+    std::vector<int> rows;                      // Строки с корректной меткой класса (по возрастанию)
+    std::vector<int> classLabels;               // Код класса -> исходная метка (по возрастанию меток)
+    std::vector<int> rowClass;                  // Код класса для каждой строки файла (-1 без метки)
+    std::vector<int> rowWeight;                 // Кратность строки после слияния повторов (пусто - все строки по одной)
+    size_t labelledRows;                        // Строк с корректной меткой до слияния повторов
+    std::vector<std::vector<int>> sortedRows;   // Для каждого атрибута: строки rows по возрастанию значения
+
+    PreparedDataset() : columns(nullptr), columnNames(nullptr), rowCount(0), labelledRows(0) {}
+
+    const NumericColumn& attributeValues(int columnIndex) const {
+        return (*columns)[columnIndex].values;
+    }
+};
+
+//ВЕС СТРОКИ ПРИ ПОДСЧЕТЕ КЛАССОВ: ЕДИНИЧНЫЙ (БЕЗ СЛИЯНИЯ ПОВТОРОВ) ИЛИ КРАТНОСТЬ ИЗ rowWeight
+struct UnitRowWeight {
+    int operator()(int) const { return 1; }
+};
+
+struct MergedRowWeight {
+    const int* weights;
+    int operator()(int row) const { return weights[row]; }
+};
+
+/**
+ * Вызывает visitor с функтором веса строки набора (единичный вес не читает память)
+ */
+template<typename Visitor>
+void dispatchRowWeight(const PreparedDataset& dataset, Visitor&& visitor) {
+    if (dataset.rowWeight.empty()) {
+        visitor(UnitRowWeight());
+    }
+    else {
+        visitor(MergedRowWeight{ dataset.rowWeight.data() });
+    }
+}
+
+/**
+ * Сливает строки с равными значениями всех атрибутов и одним классом в первую из них, вес которой -
+ * число повторов. Счетчики классов узлов складываются из весов, поэтому энтропия, прирост, SplitInfo
+ * и мажоритарный класс - а значит и дерево - совпадают с построенными по всем строкам
+ */
+void mergeDuplicateRows(PreparedDataset& prepared) {
+    const std::vector<int>& rows = prepared.rows;
+    size_t count = rows.size();
+
+    // Хеш строки по значениям атрибутов (равные значения - равные биты, -0.0 приводится к 0.0) и классу
+    std::vector<uint64_t> rowHash(count);
+    for (size_t i = 0; i < count; ++i) {
+        rowHash[i] = 14695981039346656037ULL ^ (uint64_t)prepared.rowClass[rows[i]];
+    }
+    for (int column : prepared.attributeColumns) {
+        dispatchStorage(prepared.attributeValues(column), [&](const auto& values) {
+            for (size_t i = 0; i < count; ++i) {
+                double value = (double)values[rows[i]];
+                if (value == 0.0) value = 0.0;
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                uint64_t hash = (rowHash[i] ^ bits) * 1099511628211ULL;
+                rowHash[i] = hash ^ (hash >> 29);
+            }
+        });
+    }
+
+    auto sameRow = [&](int a, int b) {
+        if (prepared.rowClass[a] != prepared.rowClass[b]) return false;
+        for (int column : prepared.attributeColumns) {
+            const NumericColumn& values = prepared.attributeValues(column);
+            if (values.at(a) != values.at(b)) return false;
+        }
+        return true;
+    };
+
+    // Строки с равным хешем идут подряд в порядке номеров: представитель группы - первая из равных строк
+    std::vector<int> order(count);
+    for (size_t i = 0; i < count; ++i) order[i] = (int)i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) {
+        return rowHash[a] < rowHash[b] || (rowHash[a] == rowHash[b] && a < b);
+    });
+
+    std::vector<int> weight(prepared.rowCount, 0);
+    std::vector<int> representatives;
+    size_t merged = 0;
+    for (size_t begin = 0; begin < count;) {
+        size_t end = begin;
+        while (end < count && rowHash[order[end]] == rowHash[order[begin]]) end++;
+
+        representatives.clear();
+        for (size_t k = begin; k < end; ++k) {
+            int row = rows[order[k]];
+            auto found = std::find_if(representatives.begin(), representatives.end(),
+                [&](int representative) { return sameRow(representative, row); });
+            if (found != representatives.end()) {
+                weight[*found]++;
+                merged++;
+            }
+            else {
+                representatives.push_back(row);
+                weight[row] = 1;
+            }
+        }
+        begin = end;
+    }
+
+    if (merged == 0) {
+        return;
+    }
+    std::vector<int> kept;
+    kept.reserve(count - merged);
+    for (int row : rows) {
+        if (weight[row] > 0) kept.push_back(row);
+    }
+    prepared.rows.swap(kept);
+    prepared.rowWeight.swap(weight);
+}
+
+PreparedDataset prepareDataset(const std::vector<ColumnData>& columns, const std::vector<std::string>& names,
+    size_t rowCount, int yIndex, const std::vector<int>& numericColumns, bool mergeDuplicates = false) {
+    PreparedDataset prepared;
+    prepared.columns = &columns;
+    prepared.columnNames = &names;
+    prepared.rowCount = rowCount;
+    prepared.attributeColumns = numericColumns;
+    prepared.rowClass.assign(rowCount, -1);
+
+    const ColumnData& yColumn = columns[yIndex];
+    if (!yColumn.hasLabels) {
+        return prepared;
+    }
+
+    for (size_t row = 0; row < rowCount; ++row) {
+        if (yColumn.labelValid[row]) {
+            prepared.rows.push_back((int)row);
+            prepared.classLabels.push_back(yColumn.labels[row]);
+        }
+    }
+    std::sort(prepared.classLabels.begin(), prepared.classLabels.end());
+    prepared.classLabels.erase(std::unique(prepared.classLabels.begin(), prepared.classLabels.end()),
+        prepared.classLabels.end());
+
+    for (int row : prepared.rows) {
+        prepared.rowClass[row] = (int)(std::lower_bound(prepared.classLabels.begin(), prepared.classLabels.end(),
+            yColumn.labels[row]) - prepared.classLabels.begin());
+    }
+    prepared.labelledRows = prepared.rows.size();
+
+    // Повторы сливаются до сортировки: сортируются и затем перебираются только уникальные строки
+    if (mergeDuplicates) {
+        mergeDuplicateRows(prepared);
+    }
+
+    prepared.sortedRows.resize(numericColumns.size());
+    for (size_t i = 0; i < numericColumns.size(); ++i) {
+        std::vector<int>& order = prepared.sortedRows[i];
+        order = prepared.rows;
+        dispatchStorage(columns[numericColumns[i]].values, [&](const auto& values) {
+            std::sort(order.begin(), order.end(), [&](int a, int b) {
+                return values[a] < values[b] || (values[a] == values[b] && a < b);
+            });
+        });
+    }
+    return prepared;
+}
+
+PreparedDataset prepareDataset(int yIndex, const std::vector<int>& numericColumns) {
+    return prepareDataset(typedColumns, columnNames, rowCount, yIndex, numericColumns);
+}
+
+//ЭНТРОПИЯ И МАЖОРИТАРНЫЙ КЛАСС ПО СЧЕТЧИКАМ КЛАССОВ (ТЕ ЖЕ ВЫЧИСЛЕНИЯ, ЧТО И ПО СПИСКУ МЕТОК)
+double entropyFromCounts(const int* counts, int classCount, int total) {
+    return entropyOfCounts<0>(counts, classCount, total);
+}
+
+int majorityFromCounts(const int* counts, int classCount) {
+    int majority = -1;
+    int maxCount = 0;
+    for (int c = 0; c < classCount; ++c) {
+        if (counts[c] > maxCount) {
+            maxCount = counts[c];
+            majority = c;
+        }
+    }
+    return majority;
+}
+
+/**
+ * Счетчики меток узла по счетчикам кодов классов (классы без строк пропускаются)
+ */
+void setLabelCounts(DecisionNode& node, const int* counts, const std::vector<int>& classLabels) {
+    node.labelCounts.clear();
+    for (size_t c = 0; c < classLabels.size(); ++c) {
+        if (counts[c] > 0) {
+            node.labelCounts.emplace_back(classLabels[c], counts[c]);
+        }
+    }
+}
+
+//ЛУЧШЕЕ РАЗДЕЛЕНИЕ УЗЛА (БЕЗ КОПИЙ СТРОК И ЖУРНАЛА)
+struct SplitChoice {
+    int attribute;              // Позиция в attributeColumns (-1 - не найдено)
+    double threshold;
+    double informationGain;
+    double splitInformation;
+    double gainRatio;
+
+    SplitChoice() : attribute(-1), threshold(0.0), informationGain(-1.0), splitInformation(0.0), gainRatio(-1.0) {
+    }
+};
+
+/**
+ * Оценка порога между соседними уникальными значениями lower < upper.
+ * left - счетчики классов по группу upper (не включая), leftBeforeGroup - до группы lower;
+ * если середина при округлении совпала с lower, группа lower уходит вправо, как в findBestSplit
+ */
+template<int K>
+inline void evaluateBoundarySplit(double lower, double upper, const int* left, int leftThrough,
+    const int* leftBeforeGroup, int groupStart, const int* nodeCounts, int classCount, int size,
+    double nodeEntropy, int attribute, int* right, SplitChoice& best) {
+
+    double threshold = (lower + upper) / 2.0;
+
+    const int* leftCounts;
+    int leftSize;
+    if (threshold > lower && threshold <= upper) {
+        leftCounts = left;
+        leftSize = leftThrough;
+    }
+    else if (threshold == lower) {
+        leftCounts = leftBeforeGroup;
+        leftSize = groupStart;
+    }
+    else {
+        return; // Переполнение при вычислении порога: одна из ветвей пуста
+    }
+
+    int rightSize = size - leftSize;
+    if (leftSize == 0 || rightSize == 0) return;
+
+    const int classes = K > 0 ? K : classCount;
+    for (int c = 0; c < classes; ++c) {
+        right[c] = nodeCounts[c] - leftCounts[c];
+    }
+
+    double leftEntropy = entropyOfCounts<K>(leftCounts, classCount, leftSize);
+    double rightEntropy = entropyOfCounts<K>(right, classCount, rightSize);
+    double weightedEntropy = ((double)leftSize / size) * leftEntropy +
+        ((double)rightSize / size) * rightEntropy;
+    double informationGain = nodeEntropy - weightedEntropy;
+    double splitInformation = calculateSplitInformation(leftSize, rightSize);
+    double gainRatio = calculateGainRatio(informationGain, splitInformation);
+
+    if (gainRatio > best.gainRatio) {
+        best.attribute = attribute;
+        best.threshold = threshold;
+        best.informationGain = informationGain;
+        best.splitInformation = splitInformation;
+        best.gainRatio = gainRatio;
+    }
+}
+
+/**
+ * Два класса: один счетчик положительного класса, остальные строки слева - класс 0.
+ * Размеры ветвей - суммы весов строк (при единичном весе - число строк)
+ */
+template<typename T, typename Weight>
+void scanPresortedBinary(const std::vector<T>& values, const int* rows, int size, const std::vector<int>& rowClass,
+    const std::vector<int>& nodeCounts, double nodeEntropy, int attribute, SplitChoice& best, Weight weight) {
+
+    int total = nodeCounts[0] + nodeCounts[1];
+    int positive = 0;
+    int seen = 0;
+    int left[2], leftBeforeGroup[2], right[2];
+
+    int i = 0;
+    while (i < size) {
+        T groupValue = values[rows[i]];
+        int groupStart = seen;
+        leftBeforeGroup[0] = groupStart - positive;
+        leftBeforeGroup[1] = positive;
+        while (i < size && values[rows[i]] == groupValue) {
+            int rowWeight = weight(rows[i]);
+            positive += rowClass[rows[i]] * rowWeight;
+            seen += rowWeight;
+            i++;
+        }
+        if (i == size) break;
+
+        left[0] = seen - positive;
+        left[1] = positive;
+        evaluateBoundarySplit<2>((double)groupValue, (double)values[rows[i]], left, seen,
+            leftBeforeGroup, groupStart, nodeCounts.data(), 2, total, nodeEntropy, attribute, right, best);
+    }
+}
+
+/**
+ * Один проход по строкам узла в порядке возрастания значения атрибута.
+ * Пороги и метрики те же, что в findBestSplit: середины соседних уникальных значений,
+ * слева - значения строго меньше порога. K - число классов (см. dispatchClassCount),
+ * weight - вес строки (слитые повторы считаются столько раз, сколько их было)
+ */
+template<int K, typename T, typename Weight = UnitRowWeight>
+void scanPresortedAttribute(const std::vector<T>& values, const int* rows, int size, const std::vector<int>& rowClass,
+    const std::vector<int>& nodeCounts, double nodeEntropy, int attribute, SplitChoice& best,
+    Weight weight = Weight()) {
+
+    if (K == 2) {
+        scanPresortedBinary(values, rows, size, rowClass, nodeCounts, nodeEntropy, attribute, best, weight);
+        return;
+    }
+
+    int classCount = K > 0 ? K : (int)nodeCounts.size();
+    ClassCounts<K> left(classCount), leftBeforeGroup(classCount), right(classCount);
+    int total = 0;
+    for (int c = 0; c < classCount; ++c) {
+        total += nodeCounts[c];
+    }
+    int seen = 0;
+
+    int i = 0;
+    while (i < size) {
+        T groupValue = values[rows[i]];
+        int groupStart = seen;
+        std::copy(left.data(), left.data() + classCount, leftBeforeGroup.data());
+        while (i < size && values[rows[i]] == groupValue) {
+            int rowWeight = weight(rows[i]);
+            left.data()[rowClass[rows[i]]] += rowWeight;
+            seen += rowWeight;
+            i++;
+        }
+        if (i == size) break;
+
+        evaluateBoundarySplit<K>((double)groupValue, (double)values[rows[i]], left.data(), seen,
+            leftBeforeGroup.data(), groupStart, nodeCounts.data(), classCount, total, nodeEntropy,
+            attribute, right.data(), best);
+    }
+}
+
+//ВЫБОРОЧНЫЙ ПОИСК ПОРОГОВ ДЛЯ БОЛЬШИХ УЗЛОВ (ОТБОР КАНДИДАТОВ ПО СЛУЧАЙНОЙ ВЫБОРКЕ СТРОК)
+
+/**
+ * Коды классов для позиций подмножества (индексы в отсортированном списке меток)
+ */
+int buildSubsetClasses(const DataSubset& data, std::vector<int>& rowClass) {
+    std::vector<int> labels = data.yValues;
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+
+    rowClass.resize(data.yValues.size());
+    for (size_t i = 0; i < data.yValues.size(); ++i) {
+        rowClass[i] = (int)(std::lower_bound(labels.begin(), labels.end(), data.yValues[i]) - labels.begin());
+    }
+    return (int)labels.size();
+}
+
+/**
+ * Лучшее разделение по атрибуту для позиций positions подмножества (позиции сортируются по значению)
+ */
+SplitChoice scanSubsetAttribute(const DataSubset& data, size_t attribute, std::vector<int>& positions,
+    const std::vector<int>& rowClass, int classCount) {
+    std::vector<int> counts(classCount, 0);
+    for (int position : positions) {
+        counts[rowClass[position]]++;
+    }
+    double entropy = entropyFromCounts(counts.data(), classCount, (int)positions.size());
+
+    SplitChoice best;
+    dispatchClassCount(classCount, [&](auto classes) {
+        dispatchStorage(data.attributeValues[attribute], [&](const auto& values) {
+            std::stable_sort(positions.begin(), positions.end(), [&](int a, int b) { return values[a] < values[b]; });
+            scanPresortedAttribute<decltype(classes)::value>(values, positions.data(), (int)positions.size(),
+                rowClass, counts, entropy, (int)attribute, best);
+        });
+    });
+    return best;
+}
+
+/**
+ * Отбор атрибутов и диапазонов порогов по выборке. Атрибут попадает в список, если его
+ * Gain Ratio на выборке не ниже лучшего на запас Хёфдинга для заданного доверия (не более shortlistSize).
+ * Диапазон порогов - окрестность лучшего порога выборки по рангу, ширина по неравенству
+ * Дворецкого-Кифера-Вольфовица для того же доверия
+ */
+std::vector<SampledCandidate> shortlistBySample(const DataSubset& data, const TrainingParams& params, int depth) {
+    int size = (int)data.yValues.size();
+    int sampleSize = std::min(params.sampleSize, size);
+
+    std::vector<int> rowClass;
+    int classCount = buildSubsetClasses(data, rowClass);
+
+    std::vector<int> sample(size);
+    for (int i = 0; i < size; ++i) sample[i] = i;
+    std::mt19937 rng((uint32_t)size * 2654435761u + (uint32_t)depth);
+    for (int i = 0; i < sampleSize; ++i) {
+        std::uniform_int_distribution<int> pick(i, size - 1);
+        std::swap(sample[i], sample[pick(rng)]);
+    }
+    sample.resize(sampleSize);
+
+    double delta = std::max(1e-12, 1.0 - params.sampleConfidence);
+    double rankMargin = sqrt(log(2.0 / delta) / (2.0 * sampleSize));
+    double gainMargin = sqrt(log(1.0 / delta) / (2.0 * sampleSize));  // Отношение приростов лежит в [0, 1], диапазон R = 1
+
+    std::vector<SampledCandidate> scored;
+    std::vector<int> positions;
+    for (size_t a = 0; a < data.attributeValues.size(); ++a) {
+        positions = sample;
+        SplitChoice best = scanSubsetAttribute(data, a, positions, rowClass, classCount);
+        if (best.attribute < 0) continue;
+
+        SampledCandidate candidate;
+        candidate.attribute = a;
+        candidate.sampleGainRatio = best.gainRatio;
+        dispatchStorage(data.attributeValues[a], [&](const auto& values) {
+            int rank = 0;
+            while (rank < sampleSize && (double)values[positions[rank]] < best.threshold) rank++;
+            int spread = (int)ceil(rankMargin * sampleSize);
+            int low = std::max(0, rank - 1 - spread);
+            int high = std::min(sampleSize - 1, rank + spread);
+            candidate.minThreshold = low == 0 ? -HUGE_VAL : (double)values[positions[low]];
+            candidate.maxThreshold = high == sampleSize - 1 ? HUGE_VAL : (double)values[positions[high]];
+        });
+        scored.push_back(candidate);
+    }
+
+    std::stable_sort(scored.begin(), scored.end(), [](const SampledCandidate& a, const SampledCandidate& b) {
+        return a.sampleGainRatio > b.sampleGainRatio;
+    });
+    std::vector<SampledCandidate> shortlist;
+    for (const SampledCandidate& candidate : scored) {
+        if ((int)shortlist.size() >= std::max(1, params.shortlistSize)) break;
+        if (!shortlist.empty() && candidate.sampleGainRatio < scored[0].sampleGainRatio - gainMargin) break;
+        shortlist.push_back(candidate);
+    }
+
+    // Точное уточнение идет в исходном порядке атрибутов - как при полном переборе
+    std::sort(shortlist.begin(), shortlist.end(), [](const SampledCandidate& a, const SampledCandidate& b) {
+        return a.attribute < b.attribute;
+    });
+    return shortlist;
+}
+
+/**
+ * Полный точный перебор за один проход по отсортированным значениям (для проверки выборочного поиска).
+ * Результат совпадает с перебором findBestSplit
+ */
+bool exactSplitBySweep(const DataSubset& data, int& attribute, double& threshold) {
+    std::vector<int> rowClass;
+    int classCount = buildSubsetClasses(data, rowClass);
+
+    SplitChoice best;
+    std::vector<int> positions;
+    for (size_t a = 0; a < data.attributeValues.size(); ++a) {
+        positions.resize(data.yValues.size());
+        for (size_t i = 0; i < positions.size(); ++i) positions[i] = (int)i;
+        SplitChoice choice = scanSubsetAttribute(data, a, positions, rowClass, classCount);
+        if (choice.gainRatio > best.gainRatio) {
+            best = choice;
+        }
+    }
+
+    if (best.attribute < 0 || best.gainRatio <= 0) {
+        return false;
+    }
+    attribute = best.attribute;
+    threshold = best.threshold;
+    return true;
+}
+
+//ПОСТРОЕНИЕ ДЕРЕВА НА ПРЕДСОРТИРОВАННЫХ СТОЛБЦАХ ПО МАСКЕ СТРОК (БЕЗ ПОДРОБНОГО ЖУРНАЛА)
+struct PresortedTreeBuilder {
+    const PreparedDataset& dataset;
+    const TrainingParams& params;
+    std::vector<std::vector<int>> attributeRows;  // Строки по каждому атрибуту; узел владеет диапазоном [begin, end)
+    std::vector<int> nodeRows;                    // Строки узлов в порядке возрастания номера
+    std::vector<uint8_t> goesLeft;                // Признак попадания строки файла в левую ветвь
+    std::vector<int> partitionBuffer;
+
+    PresortedTreeBuilder(const PreparedDataset& preparedDataset, const TrainingParams& trainingParams,
+        const std::vector<uint8_t>& rowMask) : dataset(preparedDataset), params(trainingParams) {
+
+        for (int row : dataset.rows) {
+            if (rowMask[row]) nodeRows.push_back(row);
+        }
+        attributeRows.resize(dataset.attributeColumns.size());
+        for (size_t a = 0; a < attributeRows.size(); ++a) {
+            attributeRows[a].reserve(nodeRows.size());
+            for (int row : dataset.sortedRows[a]) {
+                if (rowMask[row]) attributeRows[a].push_back(row);
+            }
+        }
+        goesLeft.assign(dataset.rowCount, 0);
+        partitionBuffer.resize(nodeRows.size());
+    }
+
+    std::unique_ptr<DecisionNode> build() {
+        return buildNode(0, nodeRows.size(), 0);
+    }
+
+    /**
+     * Устойчивое разбиение диапазона: сначала строки левой ветви, затем правой (порядок внутри сохраняется)
+     */
+    void partitionRange(std::vector<int>& rows, size_t begin, size_t end) {
+        size_t leftPos = begin;
+        size_t rightCount = 0;
+        for (size_t i = begin; i < end; ++i) {
+            int row = rows[i];
+            if (goesLeft[row]) {
+                rows[leftPos++] = row;
+            }
+            else {
+                partitionBuffer[rightCount++] = row;
+            }
+        }
+        std::copy(partitionBuffer.begin(), partitionBuffer.begin() + rightCount, rows.begin() + leftPos);
+    }
+
+    std::unique_ptr<DecisionNode> buildNode(size_t begin, size_t end, int depth) {
+        auto node = std::make_unique<DecisionNode>();
+        node->depth = depth;
+
+        // Число образцов - сумма весов строк (слитый повтор считается столько раз, сколько было строк)
+        int rowsInNode = (int)(end - begin);
+        int size = 0;
+        int classCount = (int)dataset.classLabels.size();
+        std::vector<int> counts(classCount, 0);
+        for (size_t i = begin; i < end; ++i) {
+            int row = nodeRows[i];
+            int weight = dataset.rowWeight.empty() ? 1 : dataset.rowWeight[row];
+            counts[dataset.rowClass[row]] += weight;
+            size += weight;
+        }
+        node->sampleCount = size;
+        setLabelCounts(*node, counts.data(), dataset.classLabels);
+
+        node->entropy = entropyFromCounts(counts.data(), classCount, size);
+        int majority = majorityFromCounts(counts.data(), classCount);
+        node->predictedClass = majority >= 0 ? dataset.classLabels[majority] : -1;
+
+        SplitChoice best;
+        if (!(node->entropy == 0.0 || size < params.minSamplesSplit || depth >= params.maxDepth)) {
+            dispatchRowWeight(dataset, [&](auto weight) {
+                dispatchClassCount(classCount, [&](auto classes) {
+                    for (size_t a = 0; a < dataset.attributeColumns.size(); ++a) {
+                        dispatchStorage(dataset.attributeValues(dataset.attributeColumns[a]), [&](const auto& values) {
+                            scanPresortedAttribute<decltype(classes)::value>(values, attributeRows[a].data() + begin,
+                                rowsInNode, dataset.rowClass, counts, node->entropy, (int)a, best, weight);
+                        });
+                    }
+                });
+            });
+        }
+
+        if (best.attribute < 0 || best.gainRatio <= 0) {
+            node->isLeaf = true;
+            node->nodeDescription = L"Лист: класс " + std::to_wstring(node->predictedClass);
+            return node;
+        }
+
+        //СОЗДАНИЕ ВНУТРЕННЕГО УЗЛА
+        int columnIndex = dataset.attributeColumns[best.attribute];
+        node->attributeIndex = columnIndex;
+        node->attributeName = (*dataset.columnNames)[columnIndex];
+        node->threshold = best.threshold;
+        node->informationGain = best.informationGain;
+        node->splitInformation = best.splitInformation;
+        node->gainRatio = best.gainRatio;
+        node->nodeDescription = utf8_to_wstring(node->attributeName) + L" < " +
+            std::to_wstring(node->threshold).substr(0, 5);
+
+        size_t leftCount = 0;
+        dispatchStorage(dataset.attributeValues(columnIndex), [&](const auto& values) {
+            for (size_t i = begin; i < end; ++i) {
+                int row = nodeRows[i];
+                goesLeft[row] = (double)values[row] < best.threshold ? 1 : 0;
+                leftCount += goesLeft[row];
+            }
+        });
+
+        partitionRange(nodeRows, begin, end);
+        for (auto& rows : attributeRows) {
+            partitionRange(rows, begin, end);
+        }
+
+        node->leftChild = buildNode(begin, begin + leftCount, depth + 1);
+        node->rightChild = buildNode(begin + leftCount, end, depth + 1);
+        return node;
+    }
+};
+
+//ПОСТРОЕНИЕ ДЕРЕВА ПО УРОВНЯМ: ОДИН ПРОХОД ПО КАЖДОМУ СТОЛБЦУ НА ГЛУБИНУ ДЛЯ ВСЕГО ФРОНТА
+struct LevelWiseTreeBuilder {
+    //СОСТОЯНИЕ ПРОХОДА ПО АТРИБУТУ ДЛЯ ОДНОГО УЗЛА ФРОНТА
+    struct ScanState {
+        int seen;           // Строк узла, пройденных в порядке возрастания значения
+        int groupStart;     // seen на начало текущей группы равных значений
+        double groupValue;
+    };
+
+    const PreparedDataset& dataset;
+    const TrainingParams& params;
+    std::vector<int> rowNode;                   // Номер узла фронта для строки файла (-1 - строка вне фронта)
+    std::vector<std::vector<int>> columnRows;   // Строки фронта по каждому атрибуту в порядке возрастания значения
+    std::vector<NumericColumn> columnValues;    // Значения в том же порядке и исходной ширине хранения
+    std::vector<std::vector<int>> columnClasses;    // Коды классов в том же порядке
+    std::vector<std::vector<int>> columnWeights;    // Веса строк в том же порядке (только при слиянии повторов)
+
+    LevelWiseTreeBuilder(const PreparedDataset& preparedDataset, const TrainingParams& trainingParams,
+        const std::vector<uint8_t>& rowMask) : dataset(preparedDataset), params(trainingParams) {
+
+        rowNode.assign(dataset.rowCount, -1);
+        for (int row : dataset.rows) {
+            if (rowMask[row]) rowNode[row] = 0;
+        }
+
+        columnRows.resize(dataset.attributeColumns.size());
+        columnValues.resize(dataset.attributeColumns.size());
+        columnClasses.resize(dataset.attributeColumns.size());
+        columnWeights.resize(dataset.rowWeight.empty() ? 0 : dataset.attributeColumns.size());
+        for (size_t a = 0; a < dataset.attributeColumns.size(); ++a) {
+            const NumericColumn& source = dataset.attributeValues(dataset.attributeColumns[a]);
+            columnValues[a].width = source.width;
+            dispatchStorage(source, [&](const auto& values) {
+                typedef typename std::decay<decltype(values)>::type::value_type StorageType;
+                std::vector<StorageType>& sortedValues = columnStorage<StorageType>(columnValues[a]);
+                for (int row : dataset.sortedRows[a]) {
+                    if (!rowMask[row]) continue;
+                    columnRows[a].push_back(row);
+                    sortedValues.push_back(values[row]);
+                    columnClasses[a].push_back(dataset.rowClass[row]);
+                    if (!columnWeights.empty()) columnWeights[a].push_back(dataset.rowWeight[row]);
+                }
+            });
+        }
+    }
+
+    /**
+     * Удаление строк, вышедших из фронта (попавших в листья), с сохранением порядка
+     */
+    void compactColumns() {
+        for (size_t a = 0; a < columnRows.size(); ++a) {
+            std::vector<int>& rows = columnRows[a];
+            std::vector<int>& classes = columnClasses[a];
+            int* weights = columnWeights.empty() ? nullptr : columnWeights[a].data();
+            size_t kept = 0;
+            dispatchStorage(columnValues[a], [&](auto& values) {
+                for (size_t i = 0; i < rows.size(); ++i) {
+                    if (rowNode[rows[i]] < 0) continue;
+                    rows[kept] = rows[i];
+                    values[kept] = values[i];
+                    classes[kept] = classes[i];
+                    if (weights) weights[kept] = weights[i];
+                    kept++;
+                }
+                values.resize(kept);
+            });
+            rows.resize(kept);
+            classes.resize(kept);
+            if (weights) columnWeights[a].resize(kept);
+        }
+    }
+
+    std::unique_ptr<DecisionNode> build() {
+        int classCount = (int)dataset.classLabels.size();
+        auto root = std::make_unique<DecisionNode>();
+        std::vector<DecisionNode*> frontier(1, root.get());
+
+        std::vector<int> counts, sizes, leftCounts, groupCounts, right(classCount);
+        std::vector<uint8_t> active;
+        std::vector<ScanState> scan;
+        std::vector<SplitChoice> best;
+        std::vector<int> childBase;
+        std::vector<std::vector<int>> splitRows(dataset.attributeColumns.size());  // Строки узлов по атрибуту разделения
+
+        for (int depth = 0; !frontier.empty(); ++depth) {
+            size_t frontierSize = frontier.size();
+
+            //СЧЕТЧИКИ КЛАССОВ УЗЛОВ ФРОНТА (СТРОКИ ПО ВОЗРАСТАНИЮ НОМЕРА, С ВЕСАМИ СЛИТЫХ ПОВТОРОВ)
+            counts.assign(frontierSize * classCount, 0);
+            sizes.assign(frontierSize, 0);
+            for (int row : dataset.rows) {
+                int n = rowNode[row];
+                if (n < 0) continue;
+                int classCode = dataset.rowClass[row];
+                int weight = dataset.rowWeight.empty() ? 1 : dataset.rowWeight[row];
+                counts[n * classCount + classCode] += weight;
+                sizes[n] += weight;
+            }
+
+            active.assign(frontierSize, 0);
+            bool anyActive = false;
+            for (size_t n = 0; n < frontierSize; ++n) {
+                DecisionNode* node = frontier[n];
+                node->depth = depth;
+                node->sampleCount = sizes[n];
+                setLabelCounts(*node, &counts[n * classCount], dataset.classLabels);
+                node->entropy = entropyFromCounts(&counts[n * classCount], classCount, sizes[n]);
+                int majority = majorityFromCounts(&counts[n * classCount], classCount);
+                node->predictedClass = majority >= 0 ? dataset.classLabels[majority] : -1;
+                active[n] = !(node->entropy == 0.0 || sizes[n] < params.minSamplesSplit || depth >= params.maxDepth);
+                anyActive = anyActive || active[n];
+            }
+
+            //ПОТОКОВЫЙ ПРОХОД ПО КАЖДОМУ АТРИБУТУ: СТАТИСТИКА РАЗБИЕНИЙ ДЛЯ ВСЕХ УЗЛОВ СРАЗУ
+            best.assign(frontierSize, SplitChoice());
+            dispatchClassCount(classCount, [&](auto classConstant) {
+                constexpr int K = decltype(classConstant)::value;
+                const int stride = K > 0 ? K : classCount;   // Постоянный шаг счетчиков при известном K
+
+                for (size_t a = 0; a < dataset.attributeColumns.size() && anyActive; ++a) {
+                    leftCounts.assign(frontierSize * stride, 0);
+                    groupCounts.assign(frontierSize * stride, 0);
+                    ScanState initial = { 0, 0, 0.0 };
+                    scan.assign(frontierSize, initial);
+
+                    const std::vector<int>& rows = columnRows[a];
+                    const std::vector<int>& classes = columnClasses[a];
+                    const int* weights = columnWeights.empty() ? nullptr : columnWeights[a].data();
+                    dispatchStorage(columnValues[a], [&](const auto& values) {
+                        for (size_t i = 0; i < rows.size(); ++i) {
+                            int n = rowNode[rows[i]];
+                            if (n < 0 || !active[n]) continue;
+
+                            double value = (double)values[i];
+                            ScanState& state = scan[n];
+                            int* left = &leftCounts[n * stride];
+                            int* beforeGroup = &groupCounts[n * stride];
+                            if (state.seen == 0) {
+                                state.groupValue = value;
+                            }
+                            else if (value != state.groupValue) {
+                                evaluateBoundarySplit<K>(state.groupValue, value, left, state.seen, beforeGroup,
+                                    state.groupStart, &counts[n * stride], classCount, sizes[n],
+                                    frontier[n]->entropy, (int)a, right.data(), best[n]);
+                                std::copy(left, left + stride, beforeGroup);
+                                state.groupStart = state.seen;
+                                state.groupValue = value;
+                            }
+                            int weight = weights ? weights[i] : 1;
+                            left[classes[i]] += weight;
+                            state.seen += weight;
+                        }
+                    });
+                }
+            });
+
+            //РАЗДЕЛЕНИЕ ВСЕХ УЗЛОВ ФРОНТА
+            std::vector<DecisionNode*> nextFrontier;
+            childBase.assign(frontierSize, -1);
+            for (size_t n = 0; n < frontierSize; ++n) {
+                DecisionNode* node = frontier[n];
+                if (!active[n] || best[n].attribute < 0 || best[n].gainRatio <= 0) {
+                    node->isLeaf = true;
+                    node->nodeDescription = L"Лист: класс " + std::to_wstring(node->predictedClass);
+                    continue;
+                }
+
+                int columnIndex = dataset.attributeColumns[best[n].attribute];
+                node->attributeIndex = columnIndex;
+                node->attributeName = (*dataset.columnNames)[columnIndex];
+                node->threshold = best[n].threshold;
+                node->informationGain = best[n].informationGain;
+                node->splitInformation = best[n].splitInformation;
+                node->gainRatio = best[n].gainRatio;
+                node->nodeDescription = utf8_to_wstring(node->attributeName) + L" < " +
+                    std::to_wstring(node->threshold).substr(0, 5);
+
+                node->leftChild = std::make_unique<DecisionNode>();
+                node->rightChild = std::make_unique<DecisionNode>();
+                childBase[n] = (int)nextFrontier.size();
+                nextFrontier.push_back(node->leftChild.get());
+                nextFrontier.push_back(node->rightChild.get());
+            }
+
+            //ПЕРЕНАЗНАЧЕНИЕ СТРОК ДОЧЕРНИМ УЗЛАМ: СТРОКИ РАСКЛАДЫВАЮТСЯ ПО АТРИБУТУ РАЗДЕЛЕНИЯ СВОЕГО УЗЛА,
+            //ЗАТЕМ ПРОХОД ПО КАЖДОЙ ГРУППЕ В ИСХОДНОЙ ШИРИНЕ ХРАНЕНИЯ СТОЛБЦА
+            for (std::vector<int>& rows : splitRows) {
+                rows.clear();
+            }
+            size_t frontierRows = 0;
+            for (int row : dataset.rows) {
+                int n = rowNode[row];
+                if (n < 0) continue;
+                if (childBase[n] < 0) {
+                    rowNode[row] = -1;
+                    continue;
+                }
+                splitRows[best[n].attribute].push_back(row);
+                frontierRows++;
+            }
+            for (size_t a = 0; a < splitRows.size(); ++a) {
+                const std::vector<int>& rows = splitRows[a];
+                if (rows.empty()) continue;
+                dispatchStorage(dataset.attributeValues(dataset.attributeColumns[a]), [&](const auto& values) {
+                    for (int row : rows) {
+                        int n = rowNode[row];
+                        rowNode[row] = childBase[n] + ((double)values[row] < best[n].threshold ? 0 : 1);
+                    }
+                });
+            }
+
+            // Строки листьев остаются в столбцах (пропускаются по rowNode), пока их не наберется заметная доля
+            size_t columnSize = columnRows.empty() ? 0 : columnRows[0].size();
+            if (columnSize - frontierRows > columnSize / 8) {
+                compactColumns();
+            }
+
+            frontier.swap(nextFrontier);
+        }
+        return root;
+    }
+};
+
+//ПУЛ РАБОЧИХ ПОТОКОВ
+struct ThreadPool {
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allTasksDone;
+    size_t pendingTasks;    // Задачи в очереди и выполняющиеся
+    bool stopping;
+    std::exception_ptr firstFailure;    // Первое исключение, вышедшее из задачи
+
+    explicit ThreadPool(unsigned threadCount) : pendingTasks(0), stopping(false) {
+        if (threadCount == 0) threadCount = 1;
+        for (unsigned i = 0; i < threadCount; ++i) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskAvailable.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void enqueue(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+            pendingTasks++;
+        }
+        taskAvailable.notify_one();
+    }
+
+    void waitAll() {
+        std::unique_lock<std::mutex> lock(mutex);
+        allTasksDone.wait(lock, [this] { return pendingTasks == 0; });
+    }
+
+    /**
+     * Забирает первое исключение задач (пусто - все задачи завершились без ошибок)
+     */
+    std::exception_ptr takeFailure() {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::exception_ptr failure = firstFailure;
+        firstFailure = nullptr;
+        return failure;
+    }
+
+    void workerLoop() {
+        runningInThreadPool = true;
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+
+            std::exception_ptr failure;
+            try {
+                task();
+            }
+            catch (...) {
+                failure = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (failure && !firstFailure) {
+                firstFailure = failure;
+            }
+            if (--pendingTasks == 0) {
+                allTasksDone.notify_all();
+            }
+        }
+    }
+};
+
+unsigned defaultThreadCount() {
+    unsigned count = std::thread::hardware_concurrency();
+    return count > 0 ? count : 2;
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+//РЕЗУЛЬТАТ КРОСС-ВАЛИДАЦИИ ОДНОЙ КОНФИГУРАЦИИ
+struct CrossValidationResult {
+    TrainingParams params;
+    std::vector<double> foldAccuracy;
+    std::vector<double> foldMilliseconds;   // Обучение и проверка каждого блока
+    int correct;
+    int tested;
+
+    CrossValidationResult() : correct(0), tested(0) {
+    }
+};
+
+/**
+ * k-блочная кросс-валидация для каждой конфигурации сетки. Блоки задаются масками строк
+ * над общим подготовленным набором; пары (конфигурация, блок) выполняются в пуле потоков.
+ * Исключение любой пары передается вызывающему после завершения остальных
+ */
+std::vector<CrossValidationResult> runCrossValidation(const PreparedDataset& dataset,
+    const std::vector<TrainingParams>& grid, int foldCount, unsigned seed, ThreadPool& pool) {
+
+    // Распределение строк по блокам после перемешивания
+    std::vector<int> shuffled = dataset.rows;
+    std::mt19937 generator(seed);
+    std::shuffle(shuffled.begin(), shuffled.end(), generator);
+
+    std::vector<std::vector<uint8_t>> trainMasks(foldCount, std::vector<uint8_t>(dataset.rowCount, 0));
+    std::vector<std::vector<int>> testRows(foldCount);
+    for (size_t i = 0; i < shuffled.size(); ++i) {
+        int fold = (int)(i % foldCount);
+        for (int f = 0; f < foldCount; ++f) {
+            if (f != fold) trainMasks[f][shuffled[i]] = 1;
+        }
+        testRows[fold].push_back(shuffled[i]);
+    }
+    for (auto& rows : testRows) {
+        std::sort(rows.begin(), rows.end());
+    }
+
+    std::vector<CrossValidationResult> results(grid.size());
+    std::vector<std::vector<int>> foldCorrect(grid.size(), std::vector<int>(foldCount, 0));
+    for (size_t c = 0; c < grid.size(); ++c) {
+        results[c].params = grid[c];
+        results[c].foldAccuracy.assign(foldCount, 0.0);
+        results[c].foldMilliseconds.assign(foldCount, 0.0);
+    }
+
+    for (size_t c = 0; c < grid.size(); ++c) {
+        for (int f = 0; f < foldCount; ++f) {
+            pool.enqueue([&, c, f] {
+                auto started = std::chrono::steady_clock::now();
+
+                std::unique_ptr<DecisionNode> tree = grid[c].levelWiseGrowth ?
+                    LevelWiseTreeBuilder(dataset, grid[c], trainMasks[f]).build() :
+                    PresortedTreeBuilder(dataset, grid[c], trainMasks[f]).build();
+                if (grid[c].pruningConfidence > 0.0) {
+                    pruneDecisionTree(tree.get(), grid[c].pruningConfidence);
+                }
+
+                std::vector<int> predictions = predictRows(tree.get(), *dataset.columns, dataset.rowCount, testRows[f]);
+                int correct = 0;
+                for (int row : testRows[f]) {
+                    if (predictions[row] == dataset.classLabels[dataset.rowClass[row]]) correct++;
+                }
+
+                foldCorrect[c][f] = correct;
+                results[c].foldAccuracy[f] = testRows[f].empty() ? 0.0 : (double)correct / testRows[f].size();
+                results[c].foldMilliseconds[f] = millisecondsSince(started);
+            });
+        }
+    }
+    pool.waitAll();
+    if (std::exception_ptr failure = pool.takeFailure()) {
+        std::rethrow_exception(failure);
+    }
+
+    for (size_t c = 0; c < grid.size(); ++c) {
+        for (int f = 0; f < foldCount; ++f) {
+            results[c].correct += foldCorrect[c][f];
+            results[c].tested += (int)testRows[f].size();
+        }
+    }
+    return results;
+}
+
+std::wstring describeTrainingParams(const TrainingParams& params) {
+    std::wostringstream description;
+    description << L"макс. глубина " << params.maxDepth
+        << L", мин. образцов для разделения " << params.minSamplesSplit;
+    if (params.pruningConfidence > 0.0) {
+        description << L", обрезка CF = " << std::fixed << std::setprecision(2) << params.pruningConfidence;
+    }
+    else {
+        description << L", без обрезки";
+    }
+    if (params.levelWiseGrowth) {
+        description << L", рост по уровням";
+    }
+    if (params.mergeDuplicateRows) {
+        description << L", слияние повторов";
+    }
+    return description.str();
+}
+
+//ИНКРЕМЕНТАЛЬНОЕ ОБУЧЕНИЕ ПО ДОПИСЫВАЕМЫМ СТРОКАМ (ДЕРЕВО ХЁФДИНГА, VFDT)
+
+//ПАРАМЕТРЫ ИНКРЕМЕНТАЛЬНОГО ОБУЧЕНИЯ
+struct IncrementalParams {
+    double splitConfidence;     // δ: допустимая вероятность выбрать не лучший атрибут
+    double tieThreshold;        // τ: при ε < τ лучшие атрибуты считаются равноценными
+    int gracePeriod;            // Новых образцов в листе между проверками разделения
+    int batchSize;              // Строк в одном пакете
+    int maxDepth;
+    int splitPoints;            // Порогов-кандидатов на атрибут между наименьшим и наибольшим значением
+
+    IncrementalParams() : splitConfidence(1e-6), tieThreshold(0.05), gracePeriod(200), batchSize(1000), maxDepth(10),
+        splitPoints(10) {
+    }
+};
+
+//НАБЛЮДАТЕЛЬ ЧИСЛОВОГО АТРИБУТА: НОРМАЛЬНОЕ ПРИБЛИЖЕНИЕ ЗНАЧЕНИЙ ОДНОГО КЛАССА
+//Память не зависит от числа различных значений: среднее и дисперсия (по Уэлфорду), минимум и максимум
+struct ClassGaussian {
+    int count;
+    double mean;
+    double squaredDeviations;   // Сумма квадратов отклонений от среднего
+    double minValue;
+    double maxValue;
+
+    ClassGaussian() : count(0), mean(0.0), squaredDeviations(0.0), minValue(HUGE_VAL), maxValue(-HUGE_VAL) {
+    }
+
+    void add(double value) {
+        count++;
+        double delta = value - mean;
+        mean += delta / count;
+        squaredDeviations += delta * (value - mean);
+        minValue = std::min(minValue, value);
+        maxValue = std::max(maxValue, value);
+    }
+
+    /**
+     * Оценка числа значений, строго меньших threshold
+     */
+    double countBelow(double threshold) const {
+        if (count == 0 || threshold <= minValue) return 0.0;
+        if (threshold > maxValue) return count;
+        double deviation = count > 1 ? sqrt(squaredDeviations / (count - 1)) : 0.0;
+        if (deviation == 0.0) return threshold > mean ? count : 0.0;
+        return count * 0.5 * erfc((mean - threshold) / (deviation * sqrt(2.0)));
+    }
+};
+
+//ДОСТАТОЧНАЯ СТАТИСТИКА ЛИСТА
+//classCounts/total включают строки, унаследованные от родителя, и служат только для предсказания;
+//поиск разделения и граница Хёфдинга используют лишь строки, увиденные самим листом (observed*)
+struct LeafStatistics {
+    std::vector<int> classCounts;                                 // Счетчики по кодам классов (с унаследованными)
+    std::vector<std::vector<ClassGaussian>> observers;            // Для каждого атрибута: сводка значений по кодам классов
+    std::vector<int> observedCounts;                              // Счетчики классов строк, учтенных в observers
+    int total;
+    int observedTotal;
+    int seenSinceCheck;
+    bool touched;                                                 // Есть строки пакета, сводка узла не обновлена
+
+    LeafStatistics() : total(0), observedTotal(0), seenSinceCheck(0), touched(false) {
+    }
+};
+
+struct IncrementalTree {
+    IncrementalParams params;
+    std::wstring fileName;
+    std::vector<std::string> columnNames;            // Столбцы файла на момент начала обучения
+    std::vector<int> attributeColumns;
+    int yIndex;
+    char delimiter;
+    std::vector<int> classLabels;                    // Код класса -> метка (в порядке появления)
+    std::unique_ptr<DecisionNode> root;
+    std::map<DecisionNode*, LeafStatistics> leaves;
+    std::vector<DecisionNode*> touchedLeaves;        // Листья, получившие строки в текущем пакете
+    uint64_t fileOffset;                             // Позиция в CSV, до которой строки уже учтены
+    size_t rowsLearned;
+    size_t batchesProcessed;
+    size_t splitsMade;
+    size_t prequentialCorrect;                       // Верные предсказания, сделанные до обучения на строке
+
+    IncrementalTree() : yIndex(-1), delimiter(','), fileOffset(0), rowsLearned(0), batchesProcessed(0),
+        splitsMade(0), prequentialCorrect(0) {
+    }
+};
+
+std::unique_ptr<IncrementalTree> incrementalTree;  // Дерево, дообучаемое по загруженному файлу
+
+int incrementalClassCode(IncrementalTree& tree, int label) {
+    for (size_t c = 0; c < tree.classLabels.size(); ++c) {
+        if (tree.classLabels[c] == label) return (int)c;
+    }
+    tree.classLabels.push_back(label);
+    return (int)tree.classLabels.size() - 1;
+}
+
+/**
+ * Спуск по дереву для одной строки; values индексируется номером столбца файла
+ */
+DecisionNode* routeToLeaf(DecisionNode* node, const std::vector<double>& values) {
+    while (!node->isLeaf) {
+        node = values[node->attributeIndex] < node->threshold ? node->leftChild.get() : node->rightChild.get();
+    }
+    return node;
+}
+
+void refreshLeafSummary(const IncrementalTree& tree, DecisionNode* leaf, LeafStatistics& stats) {
+    int classCount = (int)tree.classLabels.size();
+    stats.classCounts.resize(classCount, 0);
+    leaf->sampleCount = stats.total;
+    leaf->entropy = entropyFromCounts(stats.classCounts.data(), classCount, stats.total);
+    int majority = majorityFromCounts(stats.classCounts.data(), classCount);
+    leaf->predictedClass = majority >= 0 ? tree.classLabels[majority] : -1;
+    leaf->nodeDescription = L"Лист: класс " + std::to_wstring(leaf->predictedClass);
+}
+
+DecisionNode* addIncrementalLeaf(IncrementalTree& tree, std::unique_ptr<DecisionNode>& slot, int depth,
+    const std::vector<int>& initialCounts) {
+    slot = std::make_unique<DecisionNode>();
+    slot->isLeaf = true;
+    slot->depth = depth;
+
+    LeafStatistics& stats = tree.leaves[slot.get()];
+    stats.classCounts = initialCounts;
+    stats.observers.resize(tree.attributeColumns.size());
+    for (int count : initialCounts) {
+        stats.total += count;
+    }
+    refreshLeafSummary(tree, slot.get(), stats);
+    return slot.get();
+}
+
+/**
+ * Энтропия по оценкам числа строк классов (дробные счетчики наблюдателей)
+ */
+double entropyFromWeights(const double* weights, int classCount, double total) {
+    if (total <= 0.0) return 0.0;
+
+    double entropy = 0.0;
+    for (int c = 0; c < classCount; ++c) {
+        if (weights[c] > 0.0) {
+            double probability = weights[c] / total;
+            entropy -= probability * log2(probability);
+        }
+    }
+    return entropy;
+}
+
+/**
+ * Проверка разделения листа по границе Хёфдинга: лучший по приросту информации атрибут
+ * должен опережать второй на ε = sqrt(R^2 ln(1/δ) / 2n), либо ε < τ
+ */
+void attemptIncrementalSplit(IncrementalTree& tree, DecisionNode* leaf) {
+    LeafStatistics& stats = tree.leaves[leaf];
+    stats.seenSinceCheck = 0;
+
+    int classCount = (int)tree.classLabels.size();
+    if (leaf->depth >= tree.params.maxDepth || leaf->entropy == 0.0 || classCount < 2) return;
+
+    // Прирост считается по строкам, которые видели наблюдатели значений, а не по унаследованным
+    int observedTotal = stats.observedTotal;
+    stats.observedCounts.resize(classCount, 0);
+    double observedEntropy = entropyFromCounts(stats.observedCounts.data(), classCount, observedTotal);
+    if (observedTotal == 0 || observedEntropy == 0.0) return;
+
+    int bestAttribute = -1;
+    double bestGain = 0.0;
+    double secondGain = 0.0;
+    double bestThreshold = 0.0;
+    std::vector<double> bestLeftCounts;
+
+    // Пороги-кандидаты делят отрезок [минимум, максимум] атрибута на splitPoints + 1 равных частей,
+    // число строк классов слева оценивается по нормальному приближению
+    std::vector<double> left(classCount), right(classCount);
+    for (size_t a = 0; a < stats.observers.size(); ++a) {
+        const std::vector<ClassGaussian>& observer = stats.observers[a];
+        double low = HUGE_VAL;
+        double high = -HUGE_VAL;
+        for (const ClassGaussian& summary : observer) {
+            if (summary.count == 0) continue;
+            low = std::min(low, summary.minValue);
+            high = std::max(high, summary.maxValue);
+        }
+        if (!(low < high)) continue;
+
+        double attributeGain = 0.0;
+        double attributeThreshold = 0.0;
+        std::vector<double> attributeLeftCounts;
+
+        for (int k = 1; k <= tree.params.splitPoints; ++k) {
+            double threshold = low + (high - low) * k / (tree.params.splitPoints + 1);
+            double leftSize = 0.0;
+            for (int c = 0; c < classCount; ++c) {
+                left[c] = c < (int)observer.size() ? observer[c].countBelow(threshold) : 0.0;
+                right[c] = stats.observedCounts[c] - left[c];
+                leftSize += left[c];
+            }
+            double rightSize = observedTotal - leftSize;
+            if (leftSize <= 0.0 || rightSize <= 0.0) continue;
+
+            double weightedEntropy = (leftSize / observedTotal) * entropyFromWeights(left.data(), classCount, leftSize) +
+                (rightSize / observedTotal) * entropyFromWeights(right.data(), classCount, rightSize);
+            double informationGain = observedEntropy - weightedEntropy;
+
+            if (informationGain > attributeGain) {
+                attributeGain = informationGain;
+                attributeThreshold = threshold;
+                attributeLeftCounts = left;
+            }
+        }
+
+        if (attributeGain > bestGain) {
+            secondGain = bestGain;
+            bestGain = attributeGain;
+            bestAttribute = (int)a;
+            bestThreshold = attributeThreshold;
+            bestLeftCounts = attributeLeftCounts;
+        }
+        else if (attributeGain > secondGain) {
+            secondGain = attributeGain;
+        }
+    }
+
+    if (bestAttribute < 0) return;
+
+    double range = log2((double)classCount);
+    double epsilon = sqrt(range * range * log(1.0 / tree.params.splitConfidence) / (2.0 * observedTotal));
+    if (!(bestGain - secondGain > epsilon || epsilon < tree.params.tieThreshold)) return;
+
+    //ПРЕВРАЩЕНИЕ ЛИСТА ВО ВНУТРЕННИЙ УЗЕЛ (ОЦЕНКИ СЧЕТЧИКОВ ОКРУГЛЯЮТСЯ ДО ЦЕЛЫХ)
+    std::vector<int> leftCounts(classCount), rightCounts(classCount);
+    int leftSize = 0;
+    for (int c = 0; c < classCount; ++c) {
+        leftCounts[c] = std::min((int)std::lround(bestLeftCounts[c]), stats.observedCounts[c]);
+        rightCounts[c] = stats.observedCounts[c] - leftCounts[c];
+        leftSize += leftCounts[c];
+    }
+    int rightSize = observedTotal - leftSize;
+
+    int columnIndex = tree.attributeColumns[bestAttribute];
+    leaf->isLeaf = false;
+    leaf->attributeIndex = columnIndex;
+    leaf->attributeName = tree.columnNames[columnIndex];
+    leaf->threshold = bestThreshold;
+    leaf->informationGain = bestGain;
+    leaf->splitInformation = calculateSplitInformation(leftSize, rightSize);
+    leaf->gainRatio = calculateGainRatio(bestGain, leaf->splitInformation);
+    leaf->nodeDescription = utf8_to_wstring(leaf->attributeName) + L" < " +
+        std::to_wstring(leaf->threshold).substr(0, 5);
+
+    tree.leaves.erase(leaf);
+    addIncrementalLeaf(tree, leaf->leftChild, leaf->depth + 1, leftCounts);
+    addIncrementalLeaf(tree, leaf->rightChild, leaf->depth + 1, rightCounts);
+    tree.splitsMade++;
+}
+
+/**
+ * Обучение на одной строке: сначала предсказание (для последовательной оценки точности),
+ * затем обновление статистики листа. Предсказание листа пересчитывается в конце пакета
+ */
+void learnIncrementalRow(IncrementalTree& tree, const std::vector<double>& values, int label) {
+    DecisionNode* leaf = routeToLeaf(tree.root.get(), values);
+    if (leaf->predictedClass == label) {
+        tree.prequentialCorrect++;
+    }
+
+    int classCode = incrementalClassCode(tree, label);
+    int classCount = (int)tree.classLabels.size();
+    LeafStatistics& stats = tree.leaves[leaf];
+    stats.classCounts.resize(classCount, 0);
+    stats.classCounts[classCode]++;
+    stats.observedCounts.resize(classCount, 0);
+    stats.observedCounts[classCode]++;
+    for (size_t a = 0; a < tree.attributeColumns.size(); ++a) {
+        std::vector<ClassGaussian>& observer = stats.observers[a];
+        if ((int)observer.size() < classCount) {
+            observer.resize(classCount);
+        }
+        observer[classCode].add(values[tree.attributeColumns[a]]);
+    }
+    stats.total++;
+    stats.observedTotal++;
+    stats.seenSinceCheck++;
+    tree.rowsLearned++;
+
+    // Сводка листа (предсказание, энтропия) обновляется в конце пакета
+    if (!stats.touched) {
+        stats.touched = true;
+        tree.touchedLeaves.push_back(leaf);
+    }
+}
+
+/**
+ * Начинает инкрементальное обучение по файлу: дерево из одного листа, чтение со строки после заголовка
+ */
+bool startIncrementalTree(IncrementalTree& tree, const std::wstring& fileName, const std::vector<std::string>& names,
+    int yIndex, const std::vector<int>& numericColumns) {
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    // Заголовок - первая непустая запись (перевод строки в кавычках ее не завершает)
+    std::string text;
+    std::vector<char> buffer(1 << 16);
+    std::vector<std::string> fields;
+    size_t fieldCount = 0;
+    size_t position = 0;
+    bool blank = true;
+    for (;;) {
+        file.read(buffer.data(), buffer.size());
+        size_t got = (size_t)file.gcount();
+        text.append(buffer.data(), got);
+        bool more = got == buffer.size();
+        size_t end = more ? findLastCSVRecordEnd(text.data(), text.size()) : text.size();
+        while (blank && position < end) {
+            position = readCSVRecord(text.data(), position, end, detectedDelimiter, fields, fieldCount, blank);
+        }
+        if (!blank || !more) break;
+    }
+    if (blank) return false;
+    uint64_t offset = position;
+
+    tree.fileName = fileName;
+    tree.columnNames = names;
+    tree.attributeColumns = numericColumns;
+    tree.yIndex = yIndex;
+    tree.delimiter = detectedDelimiter;
+    tree.fileOffset = offset;
+    tree.leaves.clear();
+    tree.touchedLeaves.clear();
+    addIncrementalLeaf(tree, tree.root, 0, std::vector<int>());
+    return true;
+}
+
+/**
+ * Читает полные строки, дописанные в файл после fileOffset (незавершенная последняя строка
+ * остается до следующего обновления), и обучает дерево пакетами
+ */
+bool consumeAppendedRows(IncrementalTree& tree, size_t& rowsRead, size_t& batchesRead) {
+    rowsRead = 0;
+    batchesRead = 0;
+
+    std::ifstream file(tree.fileName, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = (uint64_t)file.tellg();
+    if (fileSize <= tree.fileOffset) return true;
+
+    std::string appended((size_t)(fileSize - tree.fileOffset), '\0');
+    file.seekg((std::streamoff)tree.fileOffset, std::ios::beg);
+    file.read(&appended[0], appended.size());
+
+    // Последняя запись может быть дописана не полностью - она останется до следующего обновления
+    size_t complete = findLastCSVRecordEnd(appended.data(), appended.size());
+    if (complete == 0) return true;
+
+    size_t columnCount = tree.columnNames.size();
+    std::vector<double> values(columnCount, 0.0);
+    std::vector<std::string> fields;
+    size_t fieldCount = 0;
+    bool blank = true;
+    size_t inBatch = 0;
+    size_t position = 0;
+
+    // Конец пакета: обновляем сводки листьев, получивших строки, и проверяем те из них,
+    // что накопили достаточно новых образцов (остальные листья не менялись с прошлой проверки)
+    auto finishBatch = [&]() {
+        std::vector<DecisionNode*> candidates;
+        for (DecisionNode* leaf : tree.touchedLeaves) {
+            LeafStatistics& stats = tree.leaves[leaf];
+            stats.touched = false;
+            refreshLeafSummary(tree, leaf, stats);
+            if (stats.seenSinceCheck >= tree.params.gracePeriod) {
+                candidates.push_back(leaf);
+            }
+        }
+        tree.touchedLeaves.clear();
+        for (DecisionNode* leaf : candidates) {
+            attemptIncrementalSplit(tree, leaf);
+        }
+        inBatch = 0;
+        batchesRead++;
+    };
+
+    while (position < complete) {
+        position = readCSVRecord(appended.data(), position, complete, tree.delimiter, fields, fieldCount, blank);
+        if (blank) continue;
+
+        // Недостающие поля считаются пустыми, как при загрузке файла
+        int label;
+        if (tree.yIndex >= (int)fieldCount || !parseCSVInt(fields[tree.yIndex], label)) {
+            continue;
+        }
+        for (int col : tree.attributeColumns) {
+            double value;
+            values[col] = col < (int)fieldCount && parseCSVDouble(fields[col], value) ? value : 0.0;
+        }
+
+        learnIncrementalRow(tree, values, label);
+        rowsRead++;
+
+        if (++inBatch == (size_t)tree.params.batchSize) {
+            finishBatch();
+        }
+    }
+    if (inBatch > 0) {
+        finishBatch();
+    }
+
+    tree.fileOffset += complete;
+    tree.batchesProcessed += batchesRead;
+    return true;
+}
+
+//СОХРАНЕНИЕ И ЗАГРУЗКА ОБУЧЕННОЙ МОДЕЛИ
+
+#define MODEL_FILE_SIGNATURE "C45MODEL"
+#define MODEL_FILE_VERSION 1
+#define MODEL_MAX_DEPTH 10000   // Защита от переполнения стека при разборе повреждённого файла
+
+//ПОСЛЕДНЕЕ ПОСТРОЕННОЕ ДЕРЕВО (СОХРАНЯЕТСЯ ВМЕСТЕ С ОТЧЕТОМ)
+std::unique_ptr<DecisionNode> trainedTree;
+int trainedTargetIndex = -1;
+bool resultsDescribeTrainedTree = false;   // resultsText - отчет performAnalysis о trainedTree (а не кросс-валидации или дообучения)
+
+//ЗАГРУЖЕННАЯ МОДЕЛЬ: ДЕРЕВЬЯ (АНСАМБЛЬ ФАЙЛОВ С ОДНОЙ РАСКЛАДКОЙ) И РАСКЛАДКА СТОЛБЦОВ ОБУЧАЮЩЕГО ФАЙЛА
+struct ScoringModel {
+    std::vector<std::string> columnNames;
+    int yIndex;
+    char delimiter;
+    std::vector<std::unique_ptr<DecisionNode>> trees;
+    QuickScorer scorer;             // Строится после загрузки всех деревьев
+
+    ScoringModel() : yIndex(-1), delimiter(',') {}
+};
+
+void writeModelNode(std::ofstream& out, const DecisionNode* node) {
+    if (node->isLeaf || !node->leftChild || !node->rightChild) {
+        out << "leaf " << node->predictedClass << ' ' << node->sampleCount << ' ' << node->entropy << '\n';
+        return;
+    }
+    out << "split " << node->attributeIndex << ' ' << node->threshold << ' ' << node->predictedClass << ' '
+        << node->sampleCount << ' ' << node->entropy << ' ' << node->informationGain << ' '
+        << node->splitInformation << ' ' << node->gainRatio << '\n';
+    writeModelNode(out, node->leftChild.get());
+    writeModelNode(out, node->rightChild.get());
+}
+
+/**
+ * Текстовый формат: заголовок, разделитель, индекс Y, имена столбцов,
+ * затем узлы в прямом порядке обхода (пороги с 17 значащими цифрами - без потери точности)
+ */
+bool saveModel(const std::wstring& path, const DecisionNode* root, const std::vector<std::string>& names,
+    int yIndex, char delimiter) {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open() || !root) {
+        return false;
+    }
+    out << std::setprecision(17);
+    out << MODEL_FILE_SIGNATURE << ' ' << MODEL_FILE_VERSION << '\n';
+    out << "delimiter " << (int)(unsigned char)delimiter << '\n';
+    out << "target " << yIndex << '\n';
+    out << "columns " << names.size() << '\n';
+    for (const auto& name : names) {
+        out << name << '\n';
+    }
+    writeModelNode(out, root);
+    return out.good();
+}
+
+std::unique_ptr<DecisionNode> readModelNode(std::ifstream& in, const std::vector<std::string>& names, int depth) {
+    std::string kind;
+    if (depth > MODEL_MAX_DEPTH || !(in >> kind)) {
+        return nullptr;
+    }
+
+    auto node = std::make_unique<DecisionNode>();
+    node->depth = depth;
+    if (kind == "leaf") {
+        if (!(in >> node->predictedClass >> node->sampleCount >> node->entropy)) return nullptr;
+        node->isLeaf = true;
+        node->nodeDescription = L"Лист: класс " + std::to_wstring(node->predictedClass);
+        return node;
+    }
+    if (kind != "split") {
+        return nullptr;
+    }
+
+    if (!(in >> node->attributeIndex >> node->threshold >> node->predictedClass >> node->sampleCount >>
+        node->entropy >> node->informationGain >> node->splitInformation >> node->gainRatio)) {
+        return nullptr;
+    }
+    if (node->attributeIndex < 0 || node->attributeIndex >= (int)names.size()) {
+        return nullptr;
+    }
+    node->attributeName = names[node->attributeIndex];
+    node->nodeDescription = utf8_to_wstring(node->attributeName) + L" < " +
+        std::to_wstring(node->threshold).substr(0, 5);
+
+    node->leftChild = readModelNode(in, names, depth + 1);
+    if (!node->leftChild) return nullptr;
+    node->rightChild = readModelNode(in, names, depth + 1);
+    if (!node->rightChild) return nullptr;
+    return node;
+}
+
+/**
+ * Добавляет дерево файла в модель; раскладка столбцов должна совпадать с уже загруженными деревьями
+ */
+bool loadModel(const std::wstring& path, ScoringModel& model) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    std::string signature, key;
+    int version = 0, delimiterCode = 0;
+    size_t columnCount = 0;
+    if (!(in >> signature >> version) || signature != MODEL_FILE_SIGNATURE || version != MODEL_FILE_VERSION) {
+        return false;
+    }
+    int yIndex = -1;
+    if (!(in >> key >> delimiterCode) || key != "delimiter") return false;
+    if (!(in >> key >> yIndex) || key != "target") return false;
+    if (!(in >> key >> columnCount) || key != "columns") return false;
+
+    std::string line;
+    std::getline(in, line);
+    std::vector<std::string> names;
+    for (size_t i = 0; i < columnCount; ++i) {
+        if (!std::getline(in, line)) return false;
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        names.push_back(line);
+    }
+    if (yIndex >= (int)columnCount) {
+        return false;
+    }
+    if (!model.trees.empty() &&
+        (names != model.columnNames || yIndex != model.yIndex || (char)delimiterCode != model.delimiter)) {
+        return false;
+    }
+
+    std::unique_ptr<DecisionNode> root = readModelNode(in, names, 0);
+    if (!root) {
+        return false;
+    }
+    model.columnNames = names;
+    model.yIndex = yIndex;
+    model.delimiter = (char)delimiterCode;
+    model.trees.push_back(std::move(root));
+    return true;
+}
+
+/**
+ * Путь файла модели рядом с отчетом: расширение заменяется на .c45model
+ */
+std::wstring modelPathForReport(const std::wstring& reportPath) {
+    size_t slash = reportPath.find_last_of(L"\\/");
+    size_t dot = reportPath.find_last_of(L'.');
+    if (dot == std::wstring::npos || (slash != std::wstring::npos && dot < slash)) {
+        return reportPath + L".c45model";
+    }
+    return reportPath.substr(0, dot) + L".c45model";
+}
+
+//КЭШ ОБУЧЕННЫХ МОДЕЛЕЙ: КЛЮЧ - ХЕШ РАЗОБРАННЫХ ДАННЫХ, ПАРАМЕТРОВ ОБУЧЕНИЯ И ВЕРСИИ АЛГОРИТМА
+
+#define MODEL_CACHE_ALGORITHM_VERSION 1         // Повышается при любом изменении построения дерева или отчета
+#define MODEL_CACHE_MAX_BYTES (256ull << 20)    // Сверх этого объема удаляются давно не использованные модели
+#define MODEL_CACHE_INDEX_SIGNATURE "C45MODELCACHE"
+
+//ЗАПИСЬ ОГЛАВЛЕНИЯ: ОБЪЕМ ФАЙЛОВ МОДЕЛИ И НОМЕР ПОСЛЕДНЕГО ОБРАЩЕНИЯ (ДЛЯ ВЫТЕСНЕНИЯ LRU)
+struct ModelCacheEntry {
+    uint64_t bytes;
+    uint64_t lastUse;
+
+    ModelCacheEntry() : bytes(0), lastUse(0) {}
+};
+
+//ОГЛАВЛЕНИЕ КЭША: ХРАНИТСЯ ТЕКСТОМ РЯДОМ С МОДЕЛЯМИ, ИМЯ ЗАПИСИ - 16 ШЕСТНАДЦАТЕРИЧНЫХ ЦИФР КЛЮЧА
+struct ModelCacheIndex {
+    uint32_t version;
+    uint64_t nextUse;
+    std::map<std::string, ModelCacheEntry> entries;
+
+    ModelCacheIndex() : version(MODEL_CACHE_ALGORITHM_VERSION), nextUse(1) {}
+};
+
+std::mutex modelCacheMutex;     // Пакетные задания обращаются к кэшу из нескольких потоков
+
+#define MODEL_CACHE_LOCK_TIMEOUT_MS 10000   // Дольше другой процесс кэш не держит - кэш пропускается
+
+//МЕЖПРОЦЕССНАЯ БЛОКИРОВКА КЭША: ФАЙЛ index.lock, ОТКРЫТЫЙ БЕЗ СОВМЕСТНОГО ДОСТУПА
+struct ModelCacheLock {
+    HANDLE handle;
+
+    explicit ModelCacheLock(const std::wstring& dir) : handle(INVALID_HANDLE_VALUE) {
+        std::wstring path = dir + L"index.lock";
+        auto started = std::chrono::steady_clock::now();
+        for (;;) {
+            handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_ALWAYS,
+                FILE_ATTRIBUTE_NORMAL, NULL);
+            if (handle != INVALID_HANDLE_VALUE || GetLastError() != ERROR_SHARING_VIOLATION ||
+                millisecondsSince(started) > MODEL_CACHE_LOCK_TIMEOUT_MS) {
+                break;
+            }
+            Sleep(10);
+        }
+    }
+
+    ~ModelCacheLock() {
+        if (handle != INVALID_HANDLE_VALUE) {
+            CloseHandle(handle);
+        }
+    }
+
+    bool locked() const { return handle != INVALID_HANDLE_VALUE; }
+
+    ModelCacheLock(const ModelCacheLock&) = delete;
+    ModelCacheLock& operator=(const ModelCacheLock&) = delete;
+};
+
+/**
+ * Хеш разобранного набора: имена, типы и значения столбцов (столбцы хешируются параллельно).
+ * Не зависит от формы исходного файла - тот же набор в сжатом или перекодированном файле дает тот же хеш
+ */
+uint64_t hashLoadedData(const std::vector<std::string>& names, const std::vector<ColumnData>& columns,
+    size_t rowCount, char delimiter) {
+    std::vector<uint64_t> parts(2 + 4 * columns.size(), 0);
+    parts[0] = rowCount;
+    parts[1] = (uint8_t)delimiter;
+
+    runParallel(columns.size(), [&](size_t col) {
+        const ColumnData& column = columns[col];
+        uint64_t* part = &parts[2 + 4 * col];
+        part[0] = hashBytes((const uint8_t*)names[col].data(), names[col].size());
+        if (column.isNumeric) {
+            dispatchStorage(column.values, [&](const auto& values) {
+                part[1] = hashBytes((const uint8_t*)values.data(), values.size() * sizeof(values[0])) ^
+                    ((uint64_t)column.values.width << 56);
+            });
+        }
+        if (column.hasLabels) {
+            part[2] = hashBytes((const uint8_t*)column.labels.data(), column.labels.size() * sizeof(int));
+            part[3] = hashBytes(column.labelValid.data(), column.labelValid.size());
+        }
+    });
+    return hashBytes((const uint8_t*)parts.data(), parts.size() * sizeof(uint64_t));
+}
+
+/**
+ * Ключ модели: все, от чего зависит дерево и отчет (данные, столбцы анализа, параметры, версия алгоритма)
+ */
+uint64_t computeModelCacheKey(uint64_t dataHash, int yIndex, const std::vector<int>& numericColumns,
+    const TrainingParams& params) {
+    std::ostringstream key;
+    key << std::setprecision(17);
+    key << "algorithm " << MODEL_CACHE_ALGORITHM_VERSION << " format " << MODEL_FILE_VERSION
+        << " data " << dataHash << " target " << yIndex << " attributes";
+    for (int col : numericColumns) {
+        key << ' ' << col;
+    }
+    key << " depth " << params.maxDepth << " minsplit " << params.minSamplesSplit
+        << " cf " << params.pruningConfidence << " levelwise " << params.levelWiseGrowth
+        << " sampled " << params.sampledSearchMinRows << ' ' << params.sampleSize << ' ' << params.shortlistSize
+        << ' ' << params.sampleConfidence << ' ' << params.verifySampledSearch;
+    std::string text = key.str();
+    return hashBytes((const uint8_t*)text.data(), text.size());
+}
+
+/**
+ * Каталог кэша моделей во временном каталоге (создается при первом обращении; пусто - недоступен)
+ */
+std::wstring getModelCacheDirectory() {
+    wchar_t tempPath[MAX_PATH];
+    DWORD length = GetTempPathW(MAX_PATH, tempPath);
+    if (length == 0 || length >= MAX_PATH) {
+        return L"";
+    }
+    std::wstring appDir = std::wstring(tempPath) + L"AlgortimC4.5";
+    CreateDirectoryW(appDir.c_str(), NULL);
+    std::wstring cacheDir = appDir + L"\\models";
+    CreateDirectoryW(cacheDir.c_str(), NULL);
+
+    DWORD attributes = GetFileAttributesW(cacheDir.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY)) {
+        return L"";
+    }
+    return cacheDir + L"\\";
+}
+
+std::string modelCacheName(uint64_t key) {
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << key;
+    return name.str();
+}
+
+std::wstring modelCacheModelPath(const std::wstring& dir, const std::string& name) {
+    return dir + utf8_to_wstring(name) + L".c45model";
+}
+
+std::wstring modelCacheReportPath(const std::wstring& dir, const std::string& name) {
+    return dir + utf8_to_wstring(name) + L".txt";
+}
+
+/**
+ * Читает оглавление; отсутствующее оглавление - пустой кэш. Записи читаются и при другой версии
+ * алгоритма, чтобы их файлы можно было удалить
+ */
+bool readModelCacheIndex(const std::wstring& dir, ModelCacheIndex& index) {
+    index = ModelCacheIndex();
+    std::ifstream in(dir + L"index.txt", std::ios::binary);
+    if (!in.is_open()) {
+        return true;
+    }
+
+    std::string signature, key;
+    if (!(in >> signature >> index.version) || signature != MODEL_CACHE_INDEX_SIGNATURE ||
+        !(in >> key >> index.nextUse) || key != "next") {
+        return false;
+    }
+    std::string name;
+    ModelCacheEntry entry;
+    while (in >> name >> entry.bytes >> entry.lastUse) {
+        index.entries[name] = entry;
+    }
+    return true;
+}
+
+bool writeModelCacheIndex(const std::wstring& dir, const ModelCacheIndex& index) {
+    std::wstring path = dir + L"index.txt";
+    std::wstring tempPath = path + L".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) return false;
+        out << MODEL_CACHE_INDEX_SIGNATURE << ' ' << index.version << '\n';
+        out << "next " << index.nextUse << '\n';
+        for (const auto& entry : index.entries) {
+            out << entry.first << ' ' << entry.second.bytes << ' ' << entry.second.lastUse << '\n';
+        }
+        if (!out.good()) {
+            out.close();
+            DeleteFileW(tempPath.c_str());
+            return false;
+        }
+    }
+    if (!MoveFileExW(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void removeModelCacheEntry(const std::wstring& dir, ModelCacheIndex& index, const std::string& name) {
+    DeleteFileW(modelCacheModelPath(dir, name).c_str());
+    DeleteFileW((modelCacheModelPath(dir, name) + L".tmp").c_str());
+    DeleteFileW(modelCacheReportPath(dir, name).c_str());
+    index.entries.erase(name);
+}
+
+/**
+ * Записи кэша по файлам каталога: имя -> суммарный объем файлов модели и отчета.
+ * Находит и файлы, которых нет в оглавлении (оставленные прерванным процессом)
+ */
+std::map<std::string, uint64_t> scanModelCacheDirectory(const std::wstring& dir) {
+    std::map<std::string, uint64_t> files;
+    WIN32_FIND_DATAW found;
+    HANDLE search = FindFirstFileW((dir + L"*").c_str(), &found);
+    if (search == INVALID_HANDLE_VALUE) {
+        return files;
     }
-    else {
-        steps << indent << L"Не найдено подходящего разделения\n";
+    do {
+        if (found.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+        std::string fileName = wstring_to_utf8(found.cFileName);
+        if (fileName.size() <= 16 || fileName[16] != '.' || fileName.find_first_not_of("0123456789abcdef") != 16) continue;
+        std::string extension = fileName.substr(16);
+        if (extension != ".c45model" && extension != ".c45model.tmp" && extension != ".txt") continue;
+        files[fileName.substr(0, 16)] += ((uint64_t)found.nFileSizeHigh << 32) | found.nFileSizeLow;
+    } while (FindNextFileW(search, &found));
+    FindClose(search);
+    return files;
+}
+
+/**
+ * Открывает оглавление под блокировками modelCacheMutex и ModelCacheLock. Поврежденное оглавление
+ * или другая версия алгоритма сбрасывают весь каталог. Оглавление сверяется с каталогом:
+ * файлы без записи становятся самыми старыми записями, записи без файлов отбрасываются
+ */
+bool openModelCacheIndex(const std::wstring& dir, ModelCacheIndex& index) {
+    bool valid = readModelCacheIndex(dir, index);
+    std::map<std::string, uint64_t> files = scanModelCacheDirectory(dir);
+    if (!valid || index.version != MODEL_CACHE_ALGORITHM_VERSION) {
+        for (const auto& file : files) {
+            removeModelCacheEntry(dir, index, file.first);
+        }
+        index = ModelCacheIndex();
+        return writeModelCacheIndex(dir, index);
+    }
+
+    for (auto it = index.entries.begin(); it != index.entries.end();) {
+        auto file = files.find(it->first);
+        if (file == files.end()) {
+            it = index.entries.erase(it);
+        }
+        else {
+            it->second.bytes = file->second;
+            ++it;
+        }
+    }
+    for (const auto& file : files) {
+        if (index.entries.count(file.first) == 0) {
+            ModelCacheEntry& entry = index.entries[file.first];
+            entry.bytes = file.second;
+            entry.lastUse = 0;
+        }
+    }
+    return true;
+}
+
+uint64_t fileSizeOrZero(const std::wstring& path) {
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &attributes)) {
+        return 0;
+    }
+    return ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+}
+
+/**
+ * Ищет модель по ключу. При report != nullptr нужен и сохраненный отчет (запись без отчета - промах).
+ * Найденная запись становится самой свежей; нечитаемая или чужая модель удаляется из кэша
+ */
+bool lookupCachedModel(uint64_t key, const std::vector<std::string>& names, int yIndex,
+    std::unique_ptr<DecisionNode>& tree, std::wstring* report) {
+    std::lock_guard<std::mutex> lock(modelCacheMutex);
+    std::wstring dir = getModelCacheDirectory();
+    if (dir.empty()) {
+        return false;
+    }
+    ModelCacheLock processLock(dir);
+    ModelCacheIndex index;
+    if (!processLock.locked() || !openModelCacheIndex(dir, index)) {
+        return false;
+    }
+
+    std::string name = modelCacheName(key);
+    auto found = index.entries.find(name);
+    if (found == index.entries.end()) {
+        return false;
+    }
+
+    ScoringModel model;
+    if (!loadModel(modelCacheModelPath(dir, name), model) || model.columnNames != names || model.yIndex != yIndex) {
+        removeModelCacheEntry(dir, index, name);
+        writeModelCacheIndex(dir, index);
+        return false;
+    }
+
+    if (report) {
+        std::wifstream in(modelCacheReportPath(dir, name), std::ios::binary);
+        if (!in.is_open()) {
+            return false;
+        }
+        in.imbue(std::locale(std::locale::empty(), new std::codecvt_utf8<wchar_t>));
+        std::wostringstream text;
+        text << in.rdbuf();
+        *report = text.str();
+    }
+
+    found->second.lastUse = index.nextUse++;
+    writeModelCacheIndex(dir, index);
+    tree = std::move(model.trees.front());
+    return true;
+}
+
+/**
+ * Сохраняет модель (и отчет, если он передан) под ключом, затем вытесняет давно не использованные
+ * записи, пока объем кэша превышает MODEL_CACHE_MAX_BYTES (только что сохраненная запись остается)
+ */
+bool storeCachedModel(uint64_t key, const DecisionNode* tree, const std::vector<std::string>& names, int yIndex,
+    char delimiter, const std::wstring* report) {
+    std::lock_guard<std::mutex> lock(modelCacheMutex);
+    std::wstring dir = getModelCacheDirectory();
+    if (dir.empty() || !tree) {
+        return false;
+    }
+    ModelCacheLock processLock(dir);
+    ModelCacheIndex index;
+    if (!processLock.locked() || !openModelCacheIndex(dir, index)) {
+        return false;
+    }
+
+    std::string name = modelCacheName(key);
+    std::wstring modelPath = modelCacheModelPath(dir, name);
+    std::wstring reportPath = modelCacheReportPath(dir, name);
+    std::wstring tempPath = modelPath + L".tmp";
+    if (!saveModel(tempPath, tree, names, yIndex, delimiter) ||
+        !MoveFileExW(tempPath.c_str(), modelPath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileW(tempPath.c_str());
+        return false;
+    }
+
+    if (report) {
+        std::wofstream out(reportPath, std::ios::binary | std::ios::trunc);
+        if (out.is_open()) {
+            out.imbue(std::locale(std::locale::empty(), new std::codecvt_utf8<wchar_t>));
+            out << *report;
+        }
+        if (!out.is_open() || !out.good()) {
+            out.close();
+            DeleteFileW(reportPath.c_str());
+        }
+    }
+
+    ModelCacheEntry& entry = index.entries[name];
+    entry.bytes = fileSizeOrZero(modelPath) + fileSizeOrZero(reportPath);
+    entry.lastUse = index.nextUse++;
+
+    uint64_t totalBytes = 0;
+    for (const auto& cached : index.entries) {
+        totalBytes += cached.second.bytes;
+    }
+    while (totalBytes > MODEL_CACHE_MAX_BYTES && index.entries.size() > 1) {
+        auto oldest = index.entries.end();
+        for (auto it = index.entries.begin(); it != index.entries.end(); ++it) {
+            if (it->first != name && (oldest == index.entries.end() || it->second.lastUse < oldest->second.lastUse)) {
+                oldest = it;
+            }
+        }
+        totalBytes -= oldest->second.bytes;
+        removeModelCacheEntry(dir, index, oldest->first);
+    }
+    return writeModelCacheIndex(dir, index);
+}
+
+/**
+ * Явная очистка кэша моделей (всех файлов каталога, не только записей оглавления);
+ * возвращает число удаленных записей
+ */
+size_t clearModelCache() {
+    std::lock_guard<std::mutex> lock(modelCacheMutex);
+    std::wstring dir = getModelCacheDirectory();
+    if (dir.empty()) {
+        return 0;
+    }
+    ModelCacheLock processLock(dir);
+    if (!processLock.locked()) {
+        return 0;
+    }
+
+    ModelCacheIndex index;
+    std::map<std::string, uint64_t> files = scanModelCacheDirectory(dir);
+    for (const auto& file : files) {
+        removeModelCacheEntry(dir, index, file.first);
+    }
+    DeleteFileW((dir + L"index.txt").c_str());
+    DeleteFileW((dir + L"index.txt.tmp").c_str());
+    return files.size();
+}
+
+//СЕРВЕР ПРЕДСКАЗАНИЙ: СТРОКИ CSV НА ВХОДЕ, КЛАССЫ НА ВЫХОДЕ В ТОМ ЖЕ ПОРЯДКЕ
+
+//ПАРАМЕТРЫ СЕРВЕРА
+struct ScoringServerParams {
+    std::vector<std::wstring> modelPaths;   // Несколько файлов - ансамбль с голосованием
+    std::wstring pipeName;      // Пусто - стандартные потоки ввода/вывода
+    unsigned threadCount;
+    size_t maxBatchSize;        // Наибольший размер микропакета
+    size_t maxBatchesInFlight;  // Ограничение очереди на пул (обратное давление на чтение)
+
+    ScoringServerParams() : threadCount(0), maxBatchSize(256), maxBatchesInFlight(0) {}
+};
+
+//НАКОПЛЕННАЯ СТАТИСТИКА: ПРОПУСКНАЯ СПОСОБНОСТЬ И ЗАДЕРЖКА
+struct ScoringStats {
+    static const size_t LATENCY_WINDOW = 65536;   // Задержки последних пакетов для перцентилей
+
+    std::mutex mutex;
+    std::chrono::steady_clock::time_point started;
+    uint64_t rows;
+    uint64_t batches;
+    std::vector<std::pair<double, uint32_t>> latencies;   // (задержка пакета в мс, число строк)
+    size_t latencyCursor;
+
+    ScoringStats() : started(std::chrono::steady_clock::now()), rows(0), batches(0), latencyCursor(0) {}
+
+    void record(size_t rowCount, double latencyMs) {
+        std::lock_guard<std::mutex> lock(mutex);
+        rows += rowCount;
+        batches++;
+        if (latencies.size() < LATENCY_WINDOW) {
+            latencies.emplace_back(latencyMs, (uint32_t)rowCount);
+        }
+        else {
+            latencies[latencyCursor] = std::make_pair(latencyMs, (uint32_t)rowCount);
+            latencyCursor = (latencyCursor + 1) % LATENCY_WINDOW;
+        }
+    }
+
+    /**
+     * Перцентиль задержки строки: каждая строка пакета имеет задержку своего пакета
+     */
+    static double percentile(const std::vector<std::pair<double, uint32_t>>& sorted, uint64_t total, double q) {
+        if (sorted.empty()) return 0.0;
+        uint64_t rank = (uint64_t)ceil(q * (double)total);
+        if (rank == 0) rank = 1;
+        uint64_t seen = 0;
+        for (const auto& entry : sorted) {
+            seen += entry.second;
+            if (seen >= rank) return entry.first;
+        }
+        return sorted.back().first;
+    }
+
+    std::string describe() {
+        std::vector<std::pair<double, uint32_t>> sorted;
+        uint64_t totalRows, totalBatches;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sorted = latencies;
+            totalRows = rows;
+            totalBatches = batches;
+        }
+        std::sort(sorted.begin(), sorted.end());
+        uint64_t windowRows = 0;
+        for (const auto& entry : sorted) {
+            windowRows += entry.second;
+        }
+
+        double uptimeSeconds = millisecondsSince(started) / 1000.0;
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3);
+        out << "STATS rows=" << totalRows << " batches=" << totalBatches
+            << " avg_batch=" << (totalBatches ? (double)totalRows / totalBatches : 0.0)
+            << " uptime_s=" << uptimeSeconds
+            << " throughput_rows_s=" << (uptimeSeconds > 0 ? totalRows / uptimeSeconds : 0.0)
+            << " p50_ms=" << percentile(sorted, windowRows, 0.50)
+            << " p99_ms=" << percentile(sorted, windowRows, 0.99) << '\n';
+        return out.str();
+    }
+};
+
+/**
+ * Разбор строки в раскладке обучающего файла в значения признаков model.scorer.features
+ * (байты UTF-8 разбираются readCSVRecord и parseCSVDouble, как при загрузке; fields - рабочий буфер).
+ * Строка без столбца Y (на одно поле меньше) тоже принимается; нечисловые и отсутствующие
+ * значения читаются как 0
+ */
+void parseScoringRow(const ScoringModel& model, const std::string& line, std::vector<std::string>& fields,
+    double* values) {
+    size_t fieldCount = 0;
+    bool blank = true;
+    readCSVRecord(line.data(), 0, line.size(), model.delimiter, fields, fieldCount, blank);
+    bool withoutTarget = model.yIndex >= 0 && fieldCount + 1 == model.columnNames.size();
+
+    for (size_t f = 0; f < model.scorer.features.size(); ++f) {
+        int column = model.scorer.features[f];
+        if (withoutTarget && column > model.yIndex) {
+            column--;
+        }
+        double value = 0.0;
+        if (column >= (int)fieldCount || !parseCSVDouble(fields[column], value)) {
+            value = 0.0;
+        }
+        values[f] = value;
+    }
+}
+
+/**
+ * Завершение операции на описателе, открытом с FILE_FLAG_OVERLAPPED: ожидание своего события.
+ * Чтение и запись одного канала из разных потоков так не ждут друг друга
+ */
+bool finishOverlapped(HANDLE handle, OVERLAPPED& operation, BOOL started, DWORD& transferred) {
+    if (!started && GetLastError() != ERROR_IO_PENDING) {
+        return false;
+    }
+    return GetOverlappedResult(handle, &operation, &transferred, TRUE) != FALSE;
+}
+
+/**
+ * Чтение из описателя; event != NULL - описатель перекрываемый, event - событие этого потока
+ */
+bool readSome(HANDLE input, HANDLE event, char* buffer, DWORD size, DWORD& bytesRead) {
+    bytesRead = 0;
+    if (event == NULL) {
+        return ReadFile(input, buffer, size, &bytesRead, NULL) != FALSE;
+    }
+    OVERLAPPED operation = {};
+    operation.hEvent = event;
+    return finishOverlapped(input, operation, ReadFile(input, buffer, size, NULL, &operation), bytesRead);
+}
+
+bool writeAll(HANDLE output, const std::string& text, HANDLE event = NULL) {
+    size_t written = 0;
+    while (written < text.size()) {
+        DWORD chunk = 0;
+        DWORD size = (DWORD)(text.size() - written);
+        bool ok;
+        if (event == NULL) {
+            ok = WriteFile(output, text.data() + written, size, &chunk, NULL) != FALSE;
+        }
+        else {
+            OVERLAPPED operation = {};
+            operation.hEvent = event;
+            ok = finishOverlapped(output, operation, WriteFile(output, text.data() + written, size, NULL, &operation), chunk);
+        }
+        if (!ok || chunk == 0) {
+            return false;
+        }
+        written += chunk;
+    }
+    return true;
+}
+
+//ОДНО СОЕДИНЕНИЕ: ЧТЕНИЕ СТРОК, МИКРОПАКЕТЫ В ПУЛ, УПОРЯДОЧЕННАЯ ЗАПИСЬ ОТВЕТОВ
+struct ScoringSession {
+    //ГОТОВЫЙ К ЗАПИСИ ЭЛЕМЕНТ ВЫХОДНОГО ПОТОКА
+    struct PendingOutput {
+        bool isStats;
+        std::string text;
+        size_t rowCount;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    const ScoringModel& model;
+    ThreadPool& pool;
+    ScoringStats& stats;
+    const ScoringServerParams& params;
+    HANDLE output;
+    HANDLE readEvent;       // События перекрываемого ввода-вывода (NULL - синхронные описатели)
+    HANDLE writeEvent;
+
+    std::mutex mutex;
+    std::condition_variable progress;          // Освободилось место в пуле или продвинулась запись
+    std::condition_variable writable;          // Появился элемент для потока записи
+    std::map<uint64_t, PendingOutput> ready;   // Завершённые элементы, ждущие своей очереди
+    uint64_t nextSequence;
+    uint64_t nextToWrite;
+    size_t batchesInFlight;                    // Пакеты, которые еще считаются в пуле
+    bool outputFailed;
+    bool stopping;
+    std::thread writer;
+
+    /**
+     * overlapped - output открыт с FILE_FLAG_OVERLAPPED (канал, который одновременно читается и пишется)
+     */
+    ScoringSession(const ScoringModel& model, ThreadPool& pool, ScoringStats& stats,
+        const ScoringServerParams& params, HANDLE output, bool overlapped)
+        : model(model), pool(pool), stats(stats), params(params), output(output),
+        readEvent(overlapped ? CreateEventW(NULL, TRUE, FALSE, NULL) : NULL),
+        writeEvent(overlapped ? CreateEventW(NULL, TRUE, FALSE, NULL) : NULL),
+        nextSequence(0), nextToWrite(0), batchesInFlight(0), outputFailed(overlapped && (!readEvent || !writeEvent)),
+        stopping(false) {
+        writer = std::thread([this] { writeLoop(); });
+    }
+
+    ~ScoringSession() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        writable.notify_all();
+        writer.join();
+        if (readEvent) CloseHandle(readEvent);
+        if (writeEvent) CloseHandle(writeEvent);
+    }
+
+    /**
+     * Поток записи сессии: выводит элементы по порядку номеров. Блокирующая запись идет
+     * без mutex, поэтому медленный клиент задерживает только свою сессию, а не потоки пула
+     */
+    void writeLoop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+            writable.wait(lock, [this] { return stopping || ready.count(nextToWrite) != 0; });
+            auto it = ready.find(nextToWrite);
+            if (it == ready.end()) {
+                return;
+            }
+            PendingOutput item = std::move(it->second);
+            ready.erase(it);
+            bool failed = outputFailed;
+            lock.unlock();
+
+            if (item.isStats) {
+                item.text = stats.describe();
+            }
+            if (!failed && !writeAll(output, item.text, writeEvent)) {
+                failed = true;
+            }
+            if (!item.isStats) {
+                stats.record(item.rowCount, millisecondsSince(item.received));
+            }
+
+            lock.lock();
+            outputFailed = outputFailed || failed;
+            nextToWrite++;
+            progress.notify_all();
+        }
+    }
+
+    void submitBatch(std::vector<std::string>& lines, std::chrono::steady_clock::time_point received) {
+        if (lines.empty()) return;
+
+        uint64_t sequence;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            progress.wait(lock, [this] { return batchesInFlight < params.maxBatchesInFlight; });
+            sequence = nextSequence++;
+            batchesInFlight++;
+        }
+
+        pool.enqueue([this, sequence, received, batch = std::move(lines)] {
+            size_t featureCount = model.scorer.features.size();
+            size_t treeCount = model.scorer.treeCount;
+            std::vector<double> values(batch.size() * featureCount);
+            std::vector<int> classes(batch.size() * treeCount);
+            std::vector<std::string> fields;
+            for (size_t i = 0; i < batch.size(); ++i) {
+                parseScoringRow(model, batch[i], fields, values.data() + i * featureCount);
+            }
+            model.scorer.scoreRows(values.data(), batch.size(), classes.data());
+
+            std::string text;
+            text.reserve(batch.size() * 3);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                text += std::to_string(voteEnsembleClasses(&classes[i * treeCount], treeCount));
+                text += '\n';
+            }
+
+            //ПОТОК ПУЛА ТОЛЬКО СЧИТАЕТ, ЗАПИСЬ - В ПОТОКЕ СЕССИИ
+            std::lock_guard<std::mutex> lock(mutex);
+            PendingOutput item = { false, std::move(text), batch.size(), received };
+            ready.emplace(sequence, std::move(item));
+            batchesInFlight--;
+            progress.notify_all();
+            writable.notify_one();
+        });
+        lines.clear();
+    }
+
+    void submitStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        PendingOutput item = { true, std::string(), 0, std::chrono::steady_clock::now() };
+        ready.emplace(nextSequence++, std::move(item));
+        writable.notify_one();
+    }
+
+    void waitDrained() {
+        std::unique_lock<std::mutex> lock(mutex);
+        progress.wait(lock, [this] { return nextToWrite == nextSequence; });
+    }
+
+    /**
+     * Микропакет - строки, пришедшие одним чтением (но не больше maxBatchSize):
+     * при потоке запросов пакеты растут сами, одиночный запрос не ждёт таймера
+     */
+    void run(HANDLE input) {
+        if (outputFailed) {
+            return;     // Не созданы события перекрываемого ввода-вывода
+        }
+        std::vector<char> buffer(1 << 16);
+        std::string pending;
+        std::vector<std::string> batch;
+        bool quit = false;
+
+        while (!quit) {
+            DWORD bytesRead = 0;
+            if (!readSome(input, readEvent, buffer.data(), (DWORD)buffer.size(), bytesRead) || bytesRead == 0) {
+                break;
+            }
+            auto received = std::chrono::steady_clock::now();
+            pending.append(buffer.data(), bytesRead);
+
+            size_t start = 0, newline;
+            while (!quit && (newline = pending.find('\n', start)) != std::string::npos) {
+                std::string line = pending.substr(start, newline - start);
+                start = newline + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+
+                if (line == "STATS") {
+                    submitBatch(batch, received);
+                    submitStats();
+                }
+                else if (line == "QUIT") {
+                    quit = true;
+                }
+                else if (!line.empty()) {
+                    batch.push_back(std::move(line));
+                    if (batch.size() >= params.maxBatchSize) {
+                        submitBatch(batch, received);
+                    }
+                }
+            }
+            pending.erase(0, start);
+            submitBatch(batch, received);
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (outputFailed) break;
+        }
+
+        //ПОСЛЕДНЯЯ СТРОКА БЕЗ ПЕРЕВОДА СТРОКИ
+        if (!quit && !pending.empty()) {
+            if (pending.back() == '\r') pending.pop_back();
+            if (pending == "STATS") {
+                submitStats();
+            }
+            else if (!pending.empty() && pending != "QUIT") {
+                batch.push_back(pending);
+                submitBatch(batch, std::chrono::steady_clock::now());
+            }
+        }
+        waitDrained();
+    }
+};
+
+void writeConsoleError(const std::wstring& message) {
+    HANDLE errorOutput = GetStdHandle(STD_ERROR_HANDLE);
+    if (errorOutput != NULL && errorOutput != INVALID_HANDLE_VALUE) {
+        writeAll(errorOutput, wstring_to_utf8(message) + "\n");
+    }
+}
+
+/**
+ * Разбор аргументов: --serve <модель> [<модель> ...] [--pipe <имя>] [--threads N] [--batch N]
+ */
+bool parseServerArguments(const std::vector<std::wstring>& args, ScoringServerParams& params) {
+    size_t first = 2;
+    while (first < args.size() && args[first].compare(0, 2, L"--") != 0) {
+        params.modelPaths.push_back(args[first++]);
+    }
+    if (params.modelPaths.empty()) {
+        return false;
+    }
+    for (size_t i = first; i + 1 < args.size(); i += 2) {
+        try {
+            if (args[i] == L"--pipe") {
+                params.pipeName = args[i + 1];
+                if (params.pipeName.find(L'\\') == std::wstring::npos) {
+                    params.pipeName = L"\\\\.\\pipe\\" + params.pipeName;
+                }
+            }
+            else if (args[i] == L"--threads") {
+                params.threadCount = (unsigned)std::stoul(args[i + 1]);
+            }
+            else if (args[i] == L"--batch") {
+                params.maxBatchSize = std::max<size_t>(1, std::stoul(args[i + 1]));
+            }
+            else {
+                return false;
+            }
+        }
+        catch (...) {
+            return false;
+        }
+    }
+    return (args.size() - first) % 2 == 0;
+}
+
+/**
+ * Режим сервера: модель загружается один раз, строки обслуживаются до конца ввода
+ * (стандартный ввод) или до завершения процесса (именованный канал, клиент на соединение)
+ */
+int runScoringServer(const std::vector<std::wstring>& args) {
+    ScoringServerParams params;
+    if (!parseServerArguments(args, params)) {
+        writeConsoleError(L"Использование: --serve <файл.c45model> [<файл.c45model> ...] [--pipe <имя>] [--threads N] [--batch N]");
+        return 2;
+    }
+    if (params.threadCount == 0) {
+        params.threadCount = defaultThreadCount();
+    }
+    params.maxBatchesInFlight = params.threadCount * 4;
+
+    ScoringModel model;
+    for (const std::wstring& modelPath : params.modelPaths) {
+        if (!loadModel(modelPath, model)) {
+            writeConsoleError(L"Не удалось загрузить модель: " + modelPath);
+            return 1;
+        }
+    }
+    std::vector<const DecisionNode*> trees;
+    for (const auto& tree : model.trees) {
+        trees.push_back(tree.get());
+    }
+    model.scorer.build(trees);
+
+    ThreadPool pool(params.threadCount);
+    ScoringStats stats;
+
+    if (params.pipeName.empty()) {
+        HANDLE input = GetStdHandle(STD_INPUT_HANDLE);
+        HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+        if (input == NULL || input == INVALID_HANDLE_VALUE || output == NULL || output == INVALID_HANDLE_VALUE) {
+            return 1;
+        }
+        ScoringSession session(model, pool, stats, params, output, false);
+        session.run(input);
+        return 0;
+    }
+
+    //СЕССИИ КАНАЛА: ПОТОКИ ПРИСОЕДИНЯЮТСЯ ДО РАЗРУШЕНИЯ МОДЕЛИ И ПУЛА
+    struct PipeSessionThread {
+        std::thread thread;
+        std::shared_ptr<std::atomic<bool>> finished;
+    };
+    std::list<PipeSessionThread> sessions;
+    auto joinSessions = [&sessions](bool all) {
+        for (auto it = sessions.begin(); it != sessions.end();) {
+            if (all || it->finished->load()) {
+                it->thread.join();
+                it = sessions.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    };
+
+    HANDLE connectEvent = CreateEventW(NULL, TRUE, FALSE, NULL);
+    if (connectEvent == NULL) {
+        return 1;
+    }
+    for (;;) {
+        joinSessions(false);
+
+        // Перекрываемый канал: поток записи сессии отвечает, пока ее поток чтения ждет ввода
+        HANDLE pipe = CreateNamedPipeW(params.pipeName.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+            PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, PIPE_UNLIMITED_INSTANCES, 1 << 16, 1 << 16, 0, NULL);
+        if (pipe == INVALID_HANDLE_VALUE) {
+            writeConsoleError(L"Не удалось создать именованный канал: " + params.pipeName);
+            joinSessions(true);
+            CloseHandle(connectEvent);
+            return 1;
+        }
+
+        OVERLAPPED connect = {};
+        connect.hEvent = connectEvent;
+        DWORD unused = 0;
+        BOOL connected = ConnectNamedPipe(pipe, &connect);
+        if (!connected && GetLastError() != ERROR_PIPE_CONNECTED &&
+            !finishOverlapped(pipe, connect, connected, unused)) {
+            CloseHandle(pipe);
+            continue;
+        }
+
+        std::shared_ptr<std::atomic<bool>> finished = std::make_shared<std::atomic<bool>>(false);
+        PipeSessionThread entry;
+        entry.finished = finished;
+        entry.thread = std::thread([pipe, finished, &model, &pool, &stats, &params] {
+            {
+                ScoringSession session(model, pool, stats, params, pipe, true);
+                session.run(pipe);
+            }
+            FlushFileBuffers(pipe);
+            DisconnectNamedPipe(pipe);
+            CloseHandle(pipe);
+            finished->store(true);
+        });
+        sessions.push_back(std::move(entry));
+    }
+}
+
+/**
+ * Находит целевой столбец Y и числовые атрибуты набора; при ошибке возвращает ее текст в error
+ */
+bool selectAnalysisColumns(const std::vector<std::string>& names, const std::vector<ColumnData>& columns,
+    int& yIndex, std::vector<int>& numericColumns, std::wstring& error) {
+    //ПОИСК ЦЕЛЕВОЙ ПЕРЕМЕННОЙ
+    yIndex = -1;
+    for (size_t i = 0; i < names.size(); ++i) {
+        if (isTargetColumnName(names[i])) {
+            yIndex = i;
+            break;
+        }
+    }
+
+    if (yIndex == -1) {
+        error = L"Не найден столбец 'Y' в данных!";
+        return false;
+    }
+
+    //ОПРЕДЕЛЕНИЕ ЧИСЛОВЫХ АТРИБУТОВ
+    numericColumns.clear();
+    for (size_t i = 0; i < names.size() && i < columns.size(); ++i) {
+        if ((int)i != yIndex && columns[i].isNumeric) {
+            numericColumns.push_back(i);
+        }
+    }
+
+    if (numericColumns.empty()) {
+        error = L"Не найдено числовых столбцов для анализа!";
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Находит целевой столбец Y и числовые атрибуты загруженного файла; при ошибке сообщает пользователю
+ */
+bool findAnalysisColumns(int& yIndex, std::vector<int>& numericColumns) {
+    if (rowCount == 0 || columnNames.empty()) {
+        MessageBox(hMainWindow, L"Сначала загрузите CSV файл!", L"Ошибка", MB_OK | MB_ICONWARNING);
+        return false;
+    }
+
+    std::wstring error;
+    if (!selectAnalysisColumns(columnNames, typedColumns, yIndex, numericColumns, error)) {
+        MessageBox(hMainWindow, error.c_str(), L"Ошибка", MB_OK | MB_ICONERROR);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Заголовок отчета: разделитель, размеры и атрибуты набора
+ */
+std::wstring describeDatasetForReport(const std::vector<std::string>& names, size_t count, char delimiter,
+    const std::vector<int>& numericColumns) {
+    std::wostringstream results;
+    results << L"Информация о файле:\n";
+    results << L"Обнаруженный разделитель: " << getDelimiterName(delimiter) << L"\n";
+    results << L"Количество строк: " << count << L"\n";
+    results << L"Количество столбцов: " << names.size() << L"\n";
+    results << L"Числовые атрибуты:\n";
+    for (size_t i = 0; i < numericColumns.size(); ++i) {
+        results << L"  " << utf8_to_wstring(names[numericColumns[i]]) << L"\n";
     }
+    results << L"Целевой столбец: Y\n\n";
+    return results.str();
+}
+
+//ПАКЕТНОЕ ОБУЧЕНИЕ ПО СПИСКУ ФАЙЛОВ (РЕЖИМ БЕЗ ОКНА)
+
+//ЗАДАНИЕ: ИСХОДНЫЙ ФАЙЛ, ПАРАМЕТРЫ ОБУЧЕНИЯ И ПУТИ РЕЗУЛЬТАТОВ
+struct TrainingJob {
+    std::wstring csvPath;
+    std::wstring reportPath;
+    std::wstring modelPath;
+    TrainingParams params;
+};
 
-    result.detailedSteps = steps.str();
-    return result;
-}
+//ИТОГ ЗАДАНИЯ
+struct TrainingJobResult {
+    bool succeeded;
+    std::wstring error;
+    size_t rows;
+    bool loadedFromCache;
+    bool modelFromCache;        // Дерево взято из кэша обученных моделей
+    size_t labelledRows;        // Обучающих строк (с корректной меткой класса)
+    size_t uniqueRows;          // Строк после слияния повторов
+    double loadMilliseconds;
+    double trainMilliseconds;
+
+    TrainingJobResult() : succeeded(false), rows(0), loadedFromCache(false), modelFromCache(false),
+        labelledRows(0), uniqueRows(0), loadMilliseconds(0.0), trainMilliseconds(0.0) {}
+};
 
-//РЕКУРСИВНАЯ ФУНКЦИЯ ПОСТРОЕНИЯ ДЕРЕВА C4.5
-std::unique_ptr<DecisionNode> buildDecisionTree(const DataSubset& data, const std::vector<int>& numericColumns,
-    int depth, std::wostringstream& treeLog) {
+//ПАРАМЕТРЫ ПАКЕТНОГО ЗАПУСКА
+struct TrainingJobsParams {
+    std::wstring manifestPath;
+    unsigned threadCount;       // 0 - по числу ядер
+    unsigned maxResident;       // Наборов данных в памяти одновременно (загружаемые и обучаемые)
 
-    auto node = std::make_unique<DecisionNode>();
-    node->depth = depth;
-    node->yValues = data.yValues;
-    node->entropy = calculateEntropy(data.yValues);
-    node->predictedClass = getMajorityClass(data.yValues);
+    TrainingJobsParams() : threadCount(0), maxResident(2) {}
+};
 
-    std::wstring indent = std::wstring(depth * 2, L' ');
+//ОГРАНИЧЕНИЕ ЧИСЛА НАБОРОВ ДАННЫХ В ПАМЯТИ: МЕСТО ЗАНИМАЕТСЯ ДО ЗАГРУЗКИ И ОСВОБОЖДАЕТСЯ ПОСЛЕ ОБУЧЕНИЯ
+struct ResidencyLimit {
+    std::mutex mutex;
+    std::condition_variable slotReleased;
+    unsigned freeSlots;
 
-    treeLog << indent << L"УЗЕЛ НА ГЛУБИНЕ " << depth << L":\n";
-    treeLog << indent << L"Образцов: " << data.yValues.size() << L"\n";
-    treeLog << indent << L"Энтропия: "
-        << std::fixed << std::setprecision(4) << node->entropy << L"\n";
+    explicit ResidencyLimit(unsigned slots) : freeSlots(slots > 0 ? slots : 1) {}
 
-    //УСЛОВИЯ ОСТАНОВКИ
-    if (node->entropy == 0.0 || data.yValues.size() < 2 || depth >= 10) {
-        node->isLeaf = true;
-        treeLog << indent << L"ЛИСТ: Предсказанный класс = " << node->predictedClass;
+    void acquire() {
+        std::unique_lock<std::mutex> lock(mutex);
+        slotReleased.wait(lock, [this] { return freeSlots > 0; });
+        freeSlots--;
+    }
 
-        if (node->entropy == 0.0) {
-            treeLog << L" (чистое разделение)\n";
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeSlots++;
+        }
+        slotReleased.notify_one();
+    }
+};
+
+/**
+ * Относительный путь из списка заданий отсчитывается от каталога списка
+ */
+std::wstring resolveManifestPath(const std::wstring& manifestPath, const std::wstring& path) {
+    bool absolute = (!path.empty() && (path[0] == L'\\' || path[0] == L'/')) || (path.size() > 1 && path[1] == L':');
+    size_t slash = manifestPath.find_last_of(L"\\/");
+    if (absolute || slash == std::wstring::npos) {
+        return path;
+    }
+    return manifestPath.substr(0, slash + 1) + path;
+}
+
+/**
+ * Список заданий: по строке на файл, "путь.csv [depth=N] [minsplit=N] [cf=X] [levelwise=0|1] [dedup=0|1] [out=путь]".
+ * Путь с пробелами берется в кавычки, строки с # - комментарии. Отчет пишется в <out>.txt,
+ * модель - в <out>.c45model (по умолчанию out - путь CSV без расширения)
+ */
+bool readTrainingManifest(const std::wstring& manifestPath, std::vector<TrainingJob>& jobs, std::wstring& error) {
+    std::ifstream in(manifestPath, std::ios::binary);
+    if (!in.is_open()) {
+        error = L"Не удалось открыть список заданий: " + manifestPath;
+        return false;
+    }
+
+    std::string rawLine;
+    int lineNumber = 0;
+    while (std::getline(in, rawLine)) {
+        lineNumber++;
+        if (lineNumber == 1 && rawLine.compare(0, 3, "\xEF\xBB\xBF") == 0) {
+            rawLine.erase(0, 3);
+        }
+        std::wstring line = utf8_to_wstring(rawLine);
+        size_t first = line.find_first_not_of(L" \t\r");
+        if (first == std::wstring::npos || line[first] == L'#') {
+            continue;
         }
-        else if (data.yValues.size() < 2) {
-            treeLog << L" (недостаточно образцов)\n";
+
+        std::wistringstream fields(line);
+        std::wstring csvPath, outputPrefix, field;
+        fields >> std::quoted(csvPath);
+
+        TrainingJob job;
+        bool valid = true;
+        while (valid && fields >> std::quoted(field)) {
+            size_t equals = field.find(L'=');
+            if (equals == std::wstring::npos) {
+                valid = false;
+                break;
+            }
+            std::wstring key = field.substr(0, equals);
+            std::wstring value = field.substr(equals + 1);
+            try {
+                if (key == L"depth") job.params.maxDepth = std::stoi(value);
+                else if (key == L"minsplit") job.params.minSamplesSplit = std::stoi(value);
+                else if (key == L"cf") job.params.pruningConfidence = std::stod(value);
+                else if (key == L"levelwise") job.params.levelWiseGrowth = std::stoi(value) != 0;
+                else if (key == L"dedup") job.params.mergeDuplicateRows = std::stoi(value) != 0;
+                else if (key == L"out") outputPrefix = value;
+                else valid = false;
+            }
+            catch (...) {
+                valid = false;
+            }
+        }
+        if (!valid) {
+            error = L"Ошибка в строке " + std::to_wstring(lineNumber) + L" списка заданий: " + line;
+            return false;
+        }
+
+        job.csvPath = resolveManifestPath(manifestPath, csvPath);
+        if (outputPrefix.empty()) {
+            size_t slash = job.csvPath.find_last_of(L"\\/");
+            size_t dot = job.csvPath.find_last_of(L'.');
+            outputPrefix = (dot == std::wstring::npos || (slash != std::wstring::npos && dot < slash)) ?
+                job.csvPath : job.csvPath.substr(0, dot);
         }
         else {
-            treeLog << L" (достигнута максимальная глубина)\n";
+            outputPrefix = resolveManifestPath(manifestPath, outputPrefix);
+        }
+        job.reportPath = outputPrefix + L".txt";
+        job.modelPath = outputPrefix + L".c45model";
+        if (job.reportPath == job.csvPath) {
+            job.reportPath = outputPrefix + L"_отчет.txt";
         }
+        jobs.push_back(job);
+    }
 
-        node->nodeDescription = L"Лист: класс " + std::to_wstring(node->predictedClass);
-        return node;
+    if (jobs.empty()) {
+        error = L"Список заданий пуст: " + manifestPath;
+        return false;
     }
+    return true;
+}
 
-    //ПОИСК ЛУЧШЕГО РАЗДЕЛЕНИЯ ПО C4.5
-    SplitResult split = findBestSplit(data, numericColumns, depth);
-    treeLog << split.detailedSteps;
+/**
+ * Обучение на загруженном наборе: предсортировка, построение, обрезка, запись модели и отчета.
+ * Дерево совпадает с деревом интерфейса; подробный журнал построения в пакетном режиме не ведется.
+ * Если для тех же данных и параметров модель уже есть в кэше, обучение пропускается
+ */
+bool trainLoadedDataset(const TrainingJob& job, const LoadedDataset& dataset, TrainingJobResult& result) {
+    int yIndex = -1;
+    std::vector<int> numericColumns;
+    if (!selectAnalysisColumns(dataset.columnNames, dataset.columns, yIndex, numericColumns, result.error)) {
+        return false;
+    }
 
-    if (split.bestGainRatio <= 0) {
-        node->isLeaf = true;
-        treeLog << indent << L"ЛИСТ: Предсказанный класс = " << node->predictedClass
-            << L" (нет улучшения по Gain Ratio)\n";
-        node->nodeDescription = L"Лист: класс " + std::to_wstring(node->predictedClass);
-        return node;
+    auto started = std::chrono::steady_clock::now();
+    uint64_t cacheKey = computeModelCacheKey(
+        hashLoadedData(dataset.columnNames, dataset.columns, dataset.rowCount, dataset.delimiter),
+        yIndex, numericColumns, job.params);
+    std::unique_ptr<DecisionNode> tree;
+    result.modelFromCache = lookupCachedModel(cacheKey, dataset.columnNames, yIndex, tree, nullptr);
+    if (!result.modelFromCache) {
+        PreparedDataset prepared = prepareDataset(dataset.columns, dataset.columnNames, dataset.rowCount,
+            yIndex, numericColumns, job.params.mergeDuplicateRows);
+        result.uniqueRows = prepared.rows.size();
+        result.labelledRows = prepared.labelledRows;
+        std::vector<uint8_t> allRows(dataset.rowCount, 1);
+        tree = job.params.levelWiseGrowth ?
+            LevelWiseTreeBuilder(prepared, job.params, allRows).build() :
+            PresortedTreeBuilder(prepared, job.params, allRows).build();
+        if (job.params.pruningConfidence > 0.0) {
+            pruneDecisionTree(tree.get(), job.params.pruningConfidence);
+        }
+        storeCachedModel(cacheKey, tree.get(), dataset.columnNames, yIndex, dataset.delimiter, nullptr);
     }
+    result.trainMilliseconds = millisecondsSince(started);
 
-    //СОЗДАНИЕ ВНУТРЕННЕГО УЗЛА
-    node->attributeIndex = split.bestAttributeIndex;
-    node->attributeName = columnNames[split.bestAttributeIndex];
-    node->threshold = split.bestThreshold;
-    node->informationGain = split.bestInformationGain;
-    node->splitInformation = split.bestSplitInformation;
-    node->gainRatio = split.bestGainRatio;
+    // Точность по строкам с корректной меткой класса
+    const ColumnData& yColumn = dataset.columns[yIndex];
+    std::vector<int> labelledRows;
+    for (size_t row = 0; yColumn.hasLabels && row < dataset.rowCount; ++row) {
+        if (yColumn.labelValid[row]) labelledRows.push_back((int)row);
+    }
+    std::vector<int> predictions = predictRows(tree.get(), dataset.columns, dataset.rowCount, labelledRows);
+    int correct = 0;
+    for (int row : labelledRows) {
+        if (predictions[row] == yColumn.labels[row]) correct++;
+    }
 
-    node->nodeDescription = utf8_to_wstring(node->attributeName) + L" < " +
-        std::to_wstring(node->threshold).substr(0, 5);
+    std::wostringstream report;
+    report << describeDatasetForReport(dataset.columnNames, dataset.rowCount, dataset.delimiter, numericColumns);
+    report << L"Исходный файл: " << job.csvPath << L"\n";
+    report << L"Источник: " << (result.loadedFromCache ? L"бинарный кэш" : L"разбор CSV") << L"\n";
+    report << L"Параметры: " << describeTrainingParams(job.params) << L"\n";
+    report << std::fixed << std::setprecision(1);
+    report << L"Загрузка: " << result.loadMilliseconds << L" мс, обучение: " << result.trainMilliseconds << L" мс"
+        << (result.modelFromCache ? L" (модель из кэша обученных моделей)" : L"") << L"\n";
+    if (job.params.mergeDuplicateRows && !result.modelFromCache) {
+        report << L"Слияние повторяющихся строк: " << result.labelledRows << L" -> " << result.uniqueRows
+            << L" взвешенных\n";
+    }
+    report << L"Точность на обучающих строках: " << std::setprecision(2)
+        << (labelledRows.empty() ? 0.0 : 100.0 * correct / labelledRows.size()) << L"%\n";
+    report << L"\n=== ИТОГОВОЕ ДЕРЕВО РЕШЕНИЙ ===\n\n";
+    report << printTree(tree.get());
 
-    treeLog << indent << L"ВНУТРЕННИЙ УЗЕЛ:\n";
-    treeLog << indent << L"Условие: " << utf8_to_wstring(node->attributeName)
-        << L" < " << std::fixed << std::setprecision(2) << node->threshold << L"\n";
-    treeLog << indent << L"Gain Ratio: " << std::fixed << std::setprecision(4) << node->gainRatio << L"\n\n";
+    std::wofstream file(job.reportPath);
+    if (!file.is_open()) {
+        result.error = L"Не удалось записать отчет: " + job.reportPath;
+        return false;
+    }
+    file.imbue(std::locale(std::locale::empty(), new std::codecvt_utf8<wchar_t>));
+    file << report.str();
+    file.close();
 
-    //РЕКУРСИВНОЕ ПОСТРОЕНИЕ ПОДДЕРЕВЬЕВ
-    if (!split.leftY.empty()) {
-        treeLog << indent << L"СТРОИМ ЛЕВОЕ ПОДДЕРЕВО:\n";
-        DataSubset leftData = createDataSubset(split.leftIndices,
-            std::find(columnNames.begin(), columnNames.end(), "Y") - columnNames.begin(),
-            numericColumns);
-        node->leftChild = buildDecisionTree(leftData, numericColumns, depth + 1, treeLog);
+    if (!saveModel(job.modelPath, tree.get(), dataset.columnNames, yIndex, dataset.delimiter)) {
+        result.error = L"Не удалось сохранить модель: " + job.modelPath;
+        return false;
     }
+    return true;
+}
 
-    if (!split.rightY.empty()) {
-        treeLog << indent << L"СТРОИМ ПРАВОЕ ПОДДЕРЕВО:\n";
-        DataSubset rightData = createDataSubset(split.rightIndices,
-            std::find(columnNames.begin(), columnNames.end(), "Y") - columnNames.begin(),
-            numericColumns);
-        node->rightChild = buildDecisionTree(rightData, numericColumns, depth + 1, treeLog);
+/**
+ * Выполняет задания в общем пуле: загрузка следующего файла идет параллельно с обучением текущего,
+ * но в памяти одновременно не больше maxResident наборов (место освобождается после записи результатов)
+ */
+std::vector<TrainingJobResult> runTrainingJobList(const std::vector<TrainingJob>& jobs, unsigned maxResident,
+    ThreadPool& pool) {
+    std::vector<TrainingJobResult> results(jobs.size());
+    ResidencyLimit residency(maxResident);
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        residency.acquire();
+        pool.enqueue([&, i] {
+            const TrainingJob& job = jobs[i];
+            TrainingJobResult& result = results[i];
+            std::shared_ptr<LoadedDataset> dataset;
+            bool loaded = false;
+            try {
+                auto started = std::chrono::steady_clock::now();
+                std::wstring errorTitle;
+                dataset = std::make_shared<LoadedDataset>();
+                loaded = loadDatasetFile(job.csvPath, *dataset, result.loadedFromCache, errorTitle, result.error);
+                result.loadMilliseconds = millisecondsSince(started);
+                result.rows = dataset->rowCount;
+            }
+            catch (...) {
+                result.error = L"Ошибка загрузки файла: " + describeException(std::current_exception());
+            }
+            if (!loaded) {
+                residency.release();
+                return;
+            }
+
+            // Обучение - отдельная задача пула: поток освобождается для загрузки следующего файла
+            try {
+                pool.enqueue([&, i, dataset]() mutable {
+                    try {
+                        results[i].succeeded = trainLoadedDataset(jobs[i], *dataset, results[i]);
+                    }
+                    catch (...) {
+                        results[i].succeeded = false;
+                        results[i].error = L"Ошибка обучения: " + describeException(std::current_exception());
+                    }
+                    dataset.reset();
+                    residency.release();
+                });
+            }
+            catch (...) {
+                result.error = L"Ошибка обучения: " + describeException(std::current_exception());
+                residency.release();
+            }
+        });
     }
+    pool.waitAll();
+    if (std::exception_ptr failure = pool.takeFailure()) {
+        std::rethrow_exception(failure);
+    }
+    return results;
+}
 
-    return node;
+/**
+ * Разбор аргументов: --jobs <список> [--threads N] [--resident N]
+ */
+bool parseJobArguments(const std::vector<std::wstring>& args, TrainingJobsParams& params) {
+    if (args.size() < 3 || (args.size() - 3) % 2 != 0) {
+        return false;
+    }
+    params.manifestPath = args[2];
+    for (size_t i = 3; i + 1 < args.size(); i += 2) {
+        try {
+            if (args[i] == L"--threads") {
+                params.threadCount = (unsigned)std::stoul(args[i + 1]);
+            }
+            else if (args[i] == L"--resident") {
+                params.maxResident = std::max(1u, (unsigned)std::stoul(args[i + 1]));
+            }
+            else {
+                return false;
+            }
+        }
+        catch (...) {
+            return false;
+        }
+    }
+    return true;
 }
 
-//ФУНКЦИЯ ВИЗУАЛИЗАЦИИ ДЕРЕВА C4.5
-std::wstring printTree(const DecisionNode* node, const std::wstring& prefix = L"", bool isLast = true) {
-    if (!node) return L"";
+/**
+ * Режим пакетного обучения: итог по каждому заданию выводится в стандартный вывод,
+ * код возврата 0 - все задания выполнены, 1 - есть ошибки, 2 - неверные аргументы или список
+ */
+int runTrainingJobs(const std::vector<std::wstring>& args) {
+    TrainingJobsParams params;
+    if (!parseJobArguments(args, params)) {
+        writeConsoleError(L"Использование: --jobs <список заданий> [--threads N] [--resident N]");
+        return 2;
+    }
+    if (params.threadCount == 0) {
+        params.threadCount = defaultThreadCount();
+    }
 
-    std::wostringstream result;
-    result << prefix;
-    result << (isLast ? L"└── " : L"├── ");
+    std::vector<TrainingJob> jobs;
+    std::wstring error;
+    if (!readTrainingManifest(params.manifestPath, jobs, error)) {
+        writeConsoleError(error);
+        return 2;
+    }
 
-    if (node->isLeaf) {
-        result << L"ЛИСТ: Класс " << node->predictedClass << L"\n";
-        result << prefix << (isLast ? L"    " : L"│   ")
-            << L"(энтропия: " << std::fixed << std::setprecision(4) << node->entropy
-            << L", образцов: " << node->yValues.size() << L")\n";
+    std::vector<TrainingJobResult> results;
+    auto started = std::chrono::steady_clock::now();
+    try {
+        ThreadPool pool(params.threadCount);
+        results = runTrainingJobList(jobs, params.maxResident, pool);
+    }
+    catch (...) {
+        writeConsoleError(L"Ошибка пакетного обучения: " + describeException(std::current_exception()));
+        return 1;
     }
-    else {
-        result << utf8_to_wstring(node->attributeName) << L" < "
-            << std::fixed << std::setprecision(2) << node->threshold << L"\n";
-        result << prefix << (isLast ? L"    " : L"│   ")
-            << L"(Gain Ratio: " << std::fixed << std::setprecision(4) << node->gainRatio
-            << L", IG: " << std::fixed << std::setprecision(4) << node->informationGain << L")\n";
 
-        std::wstring newPrefix = prefix + (isLast ? L"    " : L"│   ");
-        if (node->leftChild) {
-            result << printTree(node->leftChild.get(), newPrefix, !node->rightChild);
+    std::wostringstream summary;
+    summary << std::fixed << std::setprecision(1);
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const TrainingJobResult& result = results[i];
+        if (result.succeeded) {
+            summary << L"OK " << jobs[i].csvPath << L": строк " << result.rows
+                << L", загрузка " << result.loadMilliseconds << L" мс" << (result.loadedFromCache ? L" (кэш)" : L"")
+                << L", обучение " << result.trainMilliseconds << L" мс" << (result.modelFromCache ? L" (кэш моделей)" : L"")
+                << L" -> " << jobs[i].modelPath << L"\n";
         }
-        if (node->rightChild) {
-            result << printTree(node->rightChild.get(), newPrefix, true);
+        else {
+            // Текст ошибки рассчитан на диалог: в строку итога идет только его первый абзац
+            std::wstring error = result.error.substr(0, result.error.find(L"\n\n"));
+            std::replace(error.begin(), error.end(), L'\n', L' ');
+            failed++;
+            summary << L"ОШИБКА " << jobs[i].csvPath << L": " << error << L"\n";
         }
     }
+    summary << L"Заданий: " << jobs.size() << L", с ошибками: " << failed << L", потоков: " << params.threadCount
+        << L", наборов в памяти не более " << params.maxResident << L", всего " << millisecondsSince(started) << L" мс\n";
 
-    return result.str();
+    HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+    if (output != NULL && output != INVALID_HANDLE_VALUE) {
+        writeAll(output, wstring_to_utf8(summary.str()));
+    }
+    return failed == 0 ? 0 : 1;
 }
 
 //ГЛАВНАЯ ФУНКЦИЯ АНАЛИЗА C4.5
 void performAnalysis() {
-    if (csvData.empty() || columnNames.empty()) {
-        MessageBox(hMainWindow, L"Сначала загрузите CSV файл!", L"Ошибка", MB_OK | MB_ICONWARNING);
+    int yIndex = -1;
+    std::vector<int> numericColumns;
+    if (!findAnalysisColumns(yIndex, numericColumns)) {
         return;
     }
 
-    //ПОИСК ЦЕЛЕВОЙ ПЕРЕМЕННОЙ
-    int yIndex = -1;
-    for (size_t i = 0; i < columnNames.size(); ++i) {
-        if (columnNames[i] == "Y" || columnNames[i] == "y") {
-            yIndex = i;
-            break;
+    TrainingParams params;
+    if (SendMessage(hSampledSearchCheck, BM_GETCHECK, 0, 0) == BST_CHECKED) {
+        params.sampledSearchMinRows = 4 * params.sampleSize;
+        params.verifySampledSearch = SendMessage(hVerifySampledCheck, BM_GETCHECK, 0, 0) == BST_CHECKED;
+    }
+    discardMemoryPhasesAfter(loadedMemoryPhaseCount);
+
+    //ПОВТОРНОЕ ПОСТРОЕНИЕ НА ТЕХ ЖЕ ДАННЫХ С ТЕМИ ЖЕ ПАРАМЕТРАМИ - ИЗ КЭША МОДЕЛЕЙ
+    uint64_t cacheKey = computeModelCacheKey(hashLoadedData(columnNames, typedColumns, rowCount, detectedDelimiter),
+        yIndex, numericColumns, params);
+    {
+        beginMemoryPhase(L"Загрузка модели из кэша");
+        std::unique_ptr<DecisionNode> cachedTree;
+        std::wstring cachedReport;
+        bool cached = lookupCachedModel(cacheKey, columnNames, yIndex, cachedTree, &cachedReport);
+        endMemoryPhase();
+        if (cached) {
+            trainedTree = std::move(cachedTree);
+            trainedTargetIndex = yIndex;
+            resultsDescribeTrainedTree = true;
+            resultsText = cachedReport + L"\n=== КЭШ МОДЕЛЕЙ ===\n\nДерево и отчет загружены из кэша обученных моделей "
+                L"(данные и параметры не изменились), построение пропущено\n";
+            if (isMemoryTrackingEnabled()) {
+                resultsText += L"\n=== ИСПОЛЬЗОВАНИЕ ПАМЯТИ ===\n\n" + describeMemoryUsage();
+            }
+            SetWindowText(hResultsText, resultsText.c_str());
+            EnableWindow(hSaveButton, TRUE);
+            return;
         }
+        discardMemoryPhasesAfter(loadedMemoryPhaseCount);
     }
 
-    if (yIndex == -1) {
-        MessageBox(hMainWindow, L"Не найден столбец 'Y' в данных!", L"Ошибка", MB_OK | MB_ICONERROR);
-        return;
+    //ФОРМИРОВАНИЕ ОТЧЕТА
+    std::wostringstream results;
+    results << describeDatasetForReport(columnNames, rowCount, detectedDelimiter, numericColumns);
+
+    //ПОСТРОЕНИЕ ДЕРЕВА
+    beginMemoryPhase(L"Построение дерева");
+
+    std::vector<int> allIndices;
+    for (size_t i = 0; i < rowCount; ++i) {
+        allIndices.push_back(i);
     }
 
-    //ОПРЕДЕЛЕНИЕ ЧИСЛОВЫХ АТРИБУТОВ
+    DataSubset rootData = createDataSubset(allIndices, yIndex, numericColumns);
+
+    results << L"=== ДЕТАЛЬНЫЙ ПРОЦЕСС ПОСТРОЕНИЯ ДЕРЕВА ===\n\n";
+
+    SplitTrace trace;
+    sampledSearchStats = SampledSearchStats();
+    auto decisionTree = buildDecisionTree(rootData, numericColumns, 0, trace, params);
+    if (params.pruningConfidence > 0.0) {
+        pruneDecisionTree(decisionTree.get(), params.pruningConfidence);
+    }
+    endMemoryPhase();
+
+    beginMemoryPhase(L"Формирование отчета");
+    {
+        MemoryCategoryScope memoryScope(MEM_REPORT);
+        results << renderSplitTrace(trace, columnNames);
+        results << L"\n=== ИТОГОВОЕ ДЕРЕВО РЕШЕНИЙ ===\n\n";
+        results << printTree(decisionTree.get());
+
+        if (params.sampledSearchMinRows > 0) {
+            results << L"\n=== ВЫБОРОЧНЫЙ ПОИСК ПОРОГОВ ===\n\n";
+            results << L"Узлы от " << params.sampledSearchMinRows << L" строк, выборка " << params.sampleSize
+                << L", кандидатов до " << params.shortlistSize << L", доверие " << params.sampleConfidence << L"\n";
+            results << L"Узлов с выборочным поиском: " << sampledSearchStats.sampledNodes << L"\n";
+            if (params.verifySampledSearch) {
+                results << L"Сверено с полным перебором: " << sampledSearchStats.verifiedNodes << L"\n";
+                results << L"Выбрано другое разбиение: " << sampledSearchStats.mismatchedNodes;
+                if (sampledSearchStats.verifiedNodes > 0) {
+                    results << L" (" << std::fixed << std::setprecision(1)
+                        << 100.0 * sampledSearchStats.mismatchedNodes / sampledSearchStats.verifiedNodes << L"%)";
+                }
+                results << L"\n";
+            }
+        }
+        resultsText = results.str();
+    }
+    endMemoryPhase();
+
+    trainedTree = std::move(decisionTree);
+    trainedTargetIndex = yIndex;
+    resultsDescribeTrainedTree = true;
+    storeCachedModel(cacheKey, trainedTree.get(), columnNames, yIndex, detectedDelimiter, &resultsText);
+
+    if (isMemoryTrackingEnabled()) {
+        MemoryCategoryScope memoryScope(MEM_REPORT);
+        resultsText += L"\n=== ИСПОЛЬЗОВАНИЕ ПАМЯТИ ===\n\n" + describeMemoryUsage();
+    }
+    SetWindowText(hResultsText, resultsText.c_str());
+    EnableWindow(hSaveButton, TRUE);
+}
+
+//КРОСС-ВАЛИДАЦИЯ И ПЕРЕБОР ПАРАМЕТРОВ ОБУЧЕНИЯ
+void performCrossValidation() {
+    int yIndex = -1;
     std::vector<int> numericColumns;
-    for (size_t i = 0; i < columnNames.size(); ++i) {
-        if ((int)i != yIndex && isNumericColumn(i)) {
-            numericColumns.push_back(i);
+    if (!findAnalysisColumns(yIndex, numericColumns)) {
+        return;
+    }
+
+    const int foldCount = 5;
+    const unsigned seed = 42;
+    const int depths[] = { 3, 5, 7, 10 };
+    const double confidences[] = { 0.0, 0.25 };
+    const size_t levelWiseMinRows = 500000;    // С этого объема длинные проходы по столбцам выгоднее обхода в глубину
+    const int levelWiseMinDepth = 8;
+
+    std::vector<TrainingParams> grid;
+    for (int depth : depths) {
+        for (double confidence : confidences) {
+            TrainingParams params;
+            params.maxDepth = depth;
+            params.pruningConfidence = confidence;
+            params.levelWiseGrowth = rowCount >= levelWiseMinRows && depth >= levelWiseMinDepth;
+            grid.push_back(params);
         }
     }
 
-    if (numericColumns.empty()) {
-        MessageBox(hMainWindow, L"Не найдено числовых столбцов для анализа!", L"Ошибка", MB_OK | MB_ICONERROR);
+    auto started = std::chrono::steady_clock::now();
+    PreparedDataset dataset = prepareDataset(yIndex, numericColumns);
+    double preparationMilliseconds = millisecondsSince(started);
+
+    if ((int)dataset.rows.size() < foldCount) {
+        MessageBox(hMainWindow, L"Недостаточно строк с корректным Y для кросс-валидации!", L"Ошибка", MB_OK | MB_ICONERROR);
         return;
     }
 
-    //ФОРМИРОВАНИЕ ОТЧЕТА
-    std::wostringstream results;
-    // Информация о разделителе
-    results << L"Информация о файле:\n";
-    results << L"Обнаруженный разделитель: " << getDelimiterName(detectedDelimiter) << L"\n";
-    results << L"Количество строк: " << csvData.size() << L"\n";
-    results << L"Количество столбцов: " << columnNames.size() << L"\n";
-    results << L"Числовые атрибуты:\n";
-    for (size_t i = 0; i < numericColumns.size(); ++i) {
-        results << L"  " << utf8_to_wstring(columnNames[numericColumns[i]]) << L"\n";
+    ThreadPool pool(defaultThreadCount());
+    std::vector<CrossValidationResult> results;
+    try {
+        results = runCrossValidation(dataset, grid, foldCount, seed, pool);
     }
-    results << L"Целевой столбец: Y\n\n";
+    catch (...) {
+        std::wstring message = L"Ошибка кросс-валидации: " + describeException(std::current_exception());
+        MessageBox(hMainWindow, message.c_str(), L"Ошибка", MB_OK | MB_ICONERROR);
+        return;
+    }
+    double totalMilliseconds = millisecondsSince(started);
 
-    //ПОСТРОЕНИЕ ДЕРЕВА
-    std::vector<int> allIndices;
-    for (size_t i = 0; i < csvData.size(); ++i) {
-        allIndices.push_back(i);
+    //ФОРМИРОВАНИЕ ОТЧЕТА
+    std::wostringstream report;
+    report << L"=== КРОСС-ВАЛИДАЦИЯ И ПЕРЕБОР ПАРАМЕТРОВ ===\n\n";
+    report << L"Строк с корректным Y: " << dataset.rows.size() << L"\n";
+    report << L"Блоков: " << foldCount << L", конфигураций: " << grid.size()
+        << L", потоков: " << pool.workers.size() << L"\n";
+    report << L"Подготовка данных (сортировка столбцов): "
+        << std::fixed << std::setprecision(1) << preparationMilliseconds << L" мс\n";
+    report << L"Общее время: " << std::fixed << std::setprecision(1) << totalMilliseconds << L" мс\n\n";
+
+    size_t bestIndex = 0;
+    for (size_t c = 0; c < results.size(); ++c) {
+        const CrossValidationResult& result = results[c];
+        double accuracy = result.tested > 0 ? (double)result.correct / result.tested : 0.0;
+        double trainMilliseconds = 0.0;
+        for (double ms : result.foldMilliseconds) {
+            trainMilliseconds += ms;
+        }
+
+        report << describeTrainingParams(result.params) << L":\n";
+        report << L"  Точность: " << std::fixed << std::setprecision(4) << accuracy
+            << L" (" << result.correct << L" из " << result.tested << L")\n";
+        report << L"  По блокам:";
+        for (double foldAccuracy : result.foldAccuracy) {
+            report << L" " << std::fixed << std::setprecision(4) << foldAccuracy;
+        }
+        report << L"\n";
+        report << L"  Время обучения и проверки: " << std::fixed << std::setprecision(1) << trainMilliseconds
+            << L" мс (в среднем на блок " << trainMilliseconds / foldCount << L" мс)\n\n";
+
+        if (result.correct > results[bestIndex].correct) {
+            bestIndex = c;
+        }
     }
 
-    DataSubset rootData = createDataSubset(allIndices, yIndex, numericColumns);
+    report << L"ЛУЧШАЯ КОНФИГУРАЦИЯ: " << describeTrainingParams(results[bestIndex].params) << L"\n";
 
-    results << L"=== ДЕТАЛЬНЫЙ ПРОЦЕСС ПОСТРОЕНИЯ ДЕРЕВА ===\n\n";
+    resultsText = report.str();
+    resultsDescribeTrainedTree = false;
+    SetWindowText(hResultsText, resultsText.c_str());
+    EnableWindow(hSaveButton, TRUE);
+}
+
+//ДООБУЧЕНИЕ ПО СТРОКАМ, ДОПИСАННЫМ В ЗАГРУЖЕННЫЙ ФАЙЛ
+void performIncrementalUpdate() {
+    int yIndex = -1;
+    std::vector<int> numericColumns;
+    if (!findAnalysisColumns(yIndex, numericColumns)) {
+        return;
+    }
+
+    if (detectFileCompression(loadedFileName) != COMPRESSION_NONE) {
+        MessageBox(hMainWindow, L"Дообучение по сжатому файлу не поддерживается: новые строки дописываются в несжатый CSV.",
+            L"Ошибка", MB_OK | MB_ICONWARNING);
+        return;
+    }
 
-    std::wostringstream treeLog;
-    auto decisionTree = buildDecisionTree(rootData, numericColumns, 0, treeLog);
+    auto started = std::chrono::steady_clock::now();
+    if (!incrementalTree) {
+        incrementalTree = std::make_unique<IncrementalTree>();
+        if (!startIncrementalTree(*incrementalTree, loadedFileName, columnNames, yIndex, numericColumns)) {
+            incrementalTree.reset();
+            MessageBox(hMainWindow, L"Не удалось начать инкрементальное обучение по файлу!", L"Ошибка", MB_OK | MB_ICONERROR);
+            return;
+        }
+    }
 
-    results << treeLog.str();
-    results << L"\n=== ИТОГОВОЕ ДЕРЕВО РЕШЕНИЙ ===\n\n";
-    results << printTree(decisionTree.get());
+    IncrementalTree& tree = *incrementalTree;
+    size_t splitsBefore = tree.splitsMade;
+    size_t rowsRead = 0;
+    size_t batchesRead = 0;
+    if (!consumeAppendedRows(tree, rowsRead, batchesRead)) {
+        MessageBox(hMainWindow, L"Не удалось прочитать новые строки файла!", L"Ошибка", MB_OK | MB_ICONERROR);
+        return;
+    }
+    double updateMilliseconds = millisecondsSince(started);
 
-    resultsText = results.str();
+    //ФОРМИРОВАНИЕ ОТЧЕТА
+    std::wostringstream report;
+    report << L"=== ИНКРЕМЕНТАЛЬНОЕ ОБУЧЕНИЕ (ДЕРЕВО ХЁФДИНГА) ===\n\n";
+    report << L"Файл: " << tree.fileName << L"\n";
+    report << L"Новых строк: " << rowsRead << L" (пакетов: " << batchesRead << L")\n";
+    report << L"Всего обучено строк: " << tree.rowsLearned << L"\n";
+    report << L"Разделений в этом обновлении: " << tree.splitsMade - splitsBefore
+        << L", всего: " << tree.splitsMade << L"\n";
+    report << L"Листьев: " << tree.leaves.size() << L"\n";
+    if (tree.rowsLearned > 0) {
+        report << L"Последовательная точность (предсказание до обучения на строке): "
+            << std::fixed << std::setprecision(4) << (double)tree.prequentialCorrect / tree.rowsLearned << L"\n";
+    }
+    report << L"Параметры: δ = " << std::scientific << std::setprecision(0) << tree.params.splitConfidence
+        << L", τ = " << std::fixed << std::setprecision(2) << tree.params.tieThreshold
+        << L", проверка листа каждые " << tree.params.gracePeriod << L" образцов\n";
+    report << L"Время обновления: " << std::fixed << std::setprecision(1) << updateMilliseconds << L" мс\n";
+    report << L"\n=== ТЕКУЩЕЕ ДЕРЕВО ===\n\n";
+    report << printTree(tree.root.get());
+
+    resultsText = report.str();
+    resultsDescribeTrainedTree = false;
     SetWindowText(hResultsText, resultsText.c_str());
     EnableWindow(hSaveButton, TRUE);
 }
@@ -837,7 +6443,18 @@ void saveResults() {
             file.imbue(std::locale(std::locale::empty(), new std::codecvt_utf8<wchar_t>));
             file << resultsText;
             file.close();
-            MessageBox(hMainWindow, L"Дерево решений успешно сохранено!", L"Успех", MB_OK | MB_ICONINFORMATION);
+
+            std::wstring message = L"Дерево решений успешно сохранено!";
+            if (trainedTree && resultsDescribeTrainedTree) {
+                std::wstring modelPath = modelPathForReport(szFile);
+                if (saveModel(modelPath, trainedTree.get(), columnNames, trainedTargetIndex, detectedDelimiter)) {
+                    message += L"\nМодель для режима сервера: " + modelPath;
+                }
+                else {
+                    message += L"\nНе удалось сохранить модель: " + modelPath;
+                }
+            }
+            MessageBox(hMainWindow, message.c_str(), L"Успех", MB_OK | MB_ICONINFORMATION);
         }
         else {
             MessageBox(hMainWindow, L"Не удалось сохранить файл!", L"Ошибка", MB_OK | MB_ICONERROR);
@@ -856,7 +6473,7 @@ void loadCSVFile() {
     ofn.hwndOwner = hMainWindow;
     ofn.lpstrFile = szFile;
     ofn.nMaxFile = sizeof(szFile);
-    ofn.lpstrFilter = L"CSV файлы (все разделители)\0*.csv\0Текстовые файлы\0*.txt\0Все файлы\0*.*\0";
+    ofn.lpstrFilter = L"CSV файлы (все разделители)\0*.csv;*.csv.gz\0Текстовые файлы\0*.txt\0Все файлы\0*.*\0";
     ofn.nFilterIndex = 1;
     ofn.lpstrFileTitle = NULL;
     ofn.nMaxFileTitle = 0;
@@ -867,7 +6484,19 @@ void loadCSVFile() {
         // ИСПРАВЛЕНО: Передаем широкую строку напрямую, без конвертации
         std::wstring filename(szFile);
 
-        if (parseCSV(filename)) {
+        bool loadedFromCache = false;
+        memoryPhases.clear();
+        beginMemoryPhase(L"Загрузка файла");
+        bool loaded = loadDataset(filename, loadedFromCache);
+        endMemoryPhase();
+        loadedMemoryPhaseCount = memoryPhases.size();
+
+        if (loaded) {
+            loadedFileName = filename;
+            incrementalTree.reset();
+            trainedTree.reset();
+            resultsDescribeTrainedTree = false;
+
             SendMessage(hListBox, LB_RESETCONTENT, 0, 0);
             for (const auto& colName : columnNames) {
                 std::wstring wideColName = utf8_to_wstring(colName);
@@ -875,12 +6504,15 @@ void loadCSVFile() {
             }
 
             EnableWindow(hCalculateButton, TRUE);
+            EnableWindow(hCrossValidationButton, TRUE);
+            EnableWindow(hIncrementalButton, TRUE);
 
             std::wstring message = L"Файл успешно загружен!\n";
             message += L"Путь: " + filename + L"\n";
             message += L"Разделитель: " + getDelimiterName(detectedDelimiter) + L"\n";
-            message += L"Строк данных: " + std::to_wstring(csvData.size()) + L"\n";
-            message += L"Столбцов: " + std::to_wstring(columnNames.size());
+            message += L"Строк данных: " + std::to_wstring(rowCount) + L"\n";
+            message += L"Столбцов: " + std::to_wstring(columnNames.size()) + L"\n";
+            message += loadedFromCache ? L"Источник: бинарный кэш" : L"Источник: разбор CSV";
             MessageBox(hMainWindow, message.c_str(), L"Успех", MB_OK | MB_ICONINFORMATION);
         }
     }
@@ -905,6 +6537,33 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
             340, 20, 130, 30, hwnd, (HMENU)ID_SAVE_BUTTON,
             GetModuleHandle(NULL), NULL);
 
+        hCrossValidationButton = CreateWindow(L"BUTTON", L"Кросс-валидация",
+            WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON | WS_DISABLED,
+            490, 20, 150, 30, hwnd, (HMENU)ID_CROSS_VALIDATION_BUTTON,
+            GetModuleHandle(NULL), NULL);
+
+        hIncrementalButton = CreateWindow(L"BUTTON", L"Дообучить",
+            WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_PUSHBUTTON | WS_DISABLED,
+            660, 20, 120, 30, hwnd, (HMENU)ID_INCREMENTAL_BUTTON,
+            GetModuleHandle(NULL), NULL);
+
+#ifdef C45_MEMORY_TRACKING
+        hMemoryTrackingCheck = CreateWindow(L"BUTTON", L"Учет памяти",
+            WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX,
+            800, 20, 150, 30, hwnd, (HMENU)ID_MEMORY_TRACKING_CHECK,
+            GetModuleHandle(NULL), NULL);
+#endif
+
+        hSampledSearchCheck = CreateWindow(L"BUTTON", L"Выборочный поиск порогов",
+            WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX,
+            20, 230, 200, 30, hwnd, (HMENU)ID_SAMPLED_SEARCH_CHECK,
+            GetModuleHandle(NULL), NULL);
+
+        hVerifySampledCheck = CreateWindow(L"BUTTON", L"Сверять с полным перебором",
+            WS_TABSTOP | WS_VISIBLE | WS_CHILD | BS_AUTOCHECKBOX,
+            20, 260, 200, 30, hwnd, (HMENU)ID_VERIFY_SAMPLED_CHECK,
+            GetModuleHandle(NULL), NULL);
+
         hListBox = CreateWindow(L"LISTBOX", NULL,
             WS_CHILD | WS_VISIBLE | WS_VSCROLL | LBS_STANDARD,
             20, 70, 200, 150, hwnd, (HMENU)ID_LISTBOX,
@@ -927,6 +6586,15 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
         case ID_SAVE_BUTTON:
             saveResults();
             break;
+        case ID_CROSS_VALIDATION_BUTTON:
+            performCrossValidation();
+            break;
+        case ID_INCREMENTAL_BUTTON:
+            performIncrementalUpdate();
+            break;
+        case ID_MEMORY_TRACKING_CHECK:
+            setMemoryTracking(SendMessage(hMemoryTrackingCheck, BM_GETCHECK, 0, 0) == BST_CHECKED);
+            break;
         }
         break;
 
@@ -948,6 +6616,28 @@ LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 
 //ГЛАВНАЯ ФУНКЦИЯ ПРИЛОЖЕНИЯ
 int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpCmdLine, int nCmdShow) {
+    //РЕЖИМЫ БЕЗ ОКНА: СЕРВЕР ПРЕДСКАЗАНИЙ, ПАКЕТНОЕ ОБУЧЕНИЕ И ОЧИСТКА КЭША МОДЕЛЕЙ
+    int argumentCount = 0;
+    LPWSTR* arguments = CommandLineToArgvW(GetCommandLineW(), &argumentCount);
+    if (arguments) {
+        std::vector<std::wstring> args(arguments, arguments + argumentCount);
+        LocalFree(arguments);
+        if (args.size() >= 2 && args[1] == L"--serve") {
+            return runScoringServer(args);
+        }
+        if (args.size() >= 2 && args[1] == L"--jobs") {
+            return runTrainingJobs(args);
+        }
+        if (args.size() >= 2 && args[1] == L"--clear-model-cache") {
+            size_t removed = clearModelCache();
+            HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+            if (output != NULL && output != INVALID_HANDLE_VALUE) {
+                writeAll(output, wstring_to_utf8(L"Удалено моделей из кэша: " + std::to_wstring(removed)) + "\n");
+            }
+            return 0;
+        }
+    }
+
     INITCOMMONCONTROLSEX icex;
     icex.dwSize = sizeof(INITCOMMONCONTROLSEX);
     icex.dwICC = ICC_LISTVIEW_CLASSES;